@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
@@ -18,14 +19,16 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 invView;
 } ubo;
 
-layout(set = 0, binding = 1) uniform sampler2D image;
+// BindlessTextures; push.textureIndex is uniform across a draw.
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 layout(push_constant) uniform Push {
   mat4 modelMatrix;
-  mat4 normalMatrix;
+  mat3 normalMatrix;
+  uint textureIndex;
 } push;
 
 void main() {
-  vec3 imageColor = texture(image, fragUV).rgb;
+  vec3 imageColor = texture(textures[push.textureIndex], fragUV).rgb;
   outColor = vec4(imageColor, 1.0);
 }
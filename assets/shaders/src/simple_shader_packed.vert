@@ -0,0 +1,46 @@
+#version 450
+
+// Model::PackedVertex: position is normalized to the mesh bounds (the bounds transform is
+// folded into push.modelMatrix), the normal is octahedral-encoded and there is no color.
+layout(location = 0) in vec4 position;
+layout(location = 2) in vec2 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUV;
+
+struct PointLight {
+  vec4 position;
+  vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+} ubo;
+
+layout(push_constant) uniform Push {
+  mat4 modelMatrix;
+  mat3 normalMatrix;
+  uint textureIndex;
+} push;
+
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main() {
+  vec4 positionWorld = push.modelMatrix * vec4(position.xyz, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(push.normalMatrix * octDecode(normal));
+  fragPosWorld = positionWorld.xyz;
+  fragColor = vec3(1.0);
+  fragUV = uv;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fte {
+// Read-only pack of asset files, mapped whole. Layout: header, an open-addressed hash
+// table of entries keyed by path, a chunk table, the path strings, then the file data.
+// Each file is split into CHUNK_SIZE pieces that are stored either LZ4-compressed or
+// verbatim (when compression would not pay), every chunk starting CHUNK_ALIGNMENT-aligned.
+class Archive {
+public:
+    static constexpr uint32_t MAGIC = 0x41455446; // "FTEA"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t CHUNK_SIZE = 64 * 1024;
+    static constexpr uint32_t CHUNK_ALIGNMENT = 16;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t slotCount; // power of two, at most half full
+        uint32_t chunkCount;
+        uint32_t stringsSize;
+        uint64_t slotOffset;
+        uint64_t chunkOffset;
+        uint64_t stringsOffset;
+        uint64_t fileSize;
+    };
+
+    // An empty slot has pathLength == 0.
+    struct Entry {
+        uint64_t pathHash;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        uint64_t size;
+        uint32_t firstChunk;
+        uint32_t chunkCount;
+    };
+
+    // Stored verbatim when storedSize == size.
+    struct Chunk {
+        uint64_t offset;
+        uint32_t storedSize;
+        uint32_t size;
+    };
+
+    // Archive path (forward slashes, relative to the packed root) and the file to read it from.
+    using FileList = std::vector<std::pair<std::string, std::string>>;
+
+    Archive() = default;
+
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    static uint64_t hashPath(std::string_view path);
+
+    static bool write(const std::string& archivePath, const FileList& files, bool compress = true,
+        ThreadPool& threadPool = ThreadPool::shared());
+
+    bool open(const std::string& archivePath);
+
+    const Header& header() const { return *fileHeader; }
+    const Entry* find(std::string_view path) const;
+    std::string_view getPath(const Entry& entry) const;
+    // Points into the mapping when all of the entry's chunks are stored verbatim, else nullptr.
+    const uint8_t* view(const Entry& entry) const;
+    // Writes entry.size bytes to destination; chunks decompress in parallel on threadPool.
+    bool extract(const Entry& entry, uint8_t* destination, ThreadPool& threadPool = ThreadPool::shared()) const;
+
+private:
+    const Entry* slots() const;
+    const Chunk* chunks() const;
+
+    MappedFile file;
+    const Header* fileHeader = nullptr;
+};
+} // namespace fte
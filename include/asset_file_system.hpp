@@ -0,0 +1,69 @@
+#pragma once
+
+#include "archive.hpp"
+#include "mapped_file.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace fte {
+// Bytes of one asset, wherever they came from: a view into a mounted archive, a
+// decompressed copy of an archive entry, or a mapping of the loose file.
+class AssetFile {
+public:
+    AssetFile() = default;
+
+    AssetFile(const AssetFile&) = delete;
+    AssetFile& operator=(const AssetFile&) = delete;
+
+    // Same path the loose file would be opened with; see AssetFileSystem::open.
+    bool open(const std::string& filepath);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const uint8_t* data() const { return fileData; }
+    size_t size() const { return fileSize; }
+
+private:
+    friend class AssetFileSystem;
+
+    MappedFile mappedFile;
+    std::vector<uint8_t> buffer;
+    const uint8_t* fileData = nullptr;
+    size_t fileSize = 0;
+    bool opened = false;
+};
+
+// Archives mounted over directories. A path under a mount point is looked up in that
+// archive (most recent mount first) and only falls back to the disk when no archive
+// has it, so a packed build never touches loose files.
+class AssetFileSystem {
+public:
+    static AssetFileSystem& shared();
+
+    // Archive entries are relative to mountPoint, as written by the fte_packer tool.
+    bool mount(const std::string& archivePath, const std::string& mountPoint);
+    bool open(const std::string& filepath, AssetFile& file) const;
+    bool exists(const std::string& filepath) const;
+
+private:
+    struct Mount {
+        std::filesystem::path root;
+        std::unique_ptr<Archive> archive;
+    };
+
+    // Most recent mount holding filepath; the caller holds the lock.
+    const Archive::Entry* findEntry(const std::string& filepath, const Archive*& archive) const;
+
+    mutable std::shared_mutex mutex;
+    std::vector<Mount> mounts;
+};
+
+// Sibling of filepath that no other writer, in this process or another, uses at the same
+// time. Caches are written there and renamed over filepath, so concurrent loads of one
+// asset never interleave their bytes in a shared temporary file.
+std::string makeTempPath(const std::string& filepath);
+} // namespace fte
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace fte {
+// Shared reference to an asset that may still be streaming in. Until the loader
+// publishes the real resource, get() returns the placeholder, so callers can draw
+// with a handle right away. Handles are read and resolved on the main thread only.
+template <typename T>
+class AssetHandle {
+public:
+    struct State {
+        std::shared_ptr<T> resource;
+        std::shared_ptr<T> placeholder;
+        bool failed = false;
+    };
+
+    AssetHandle() = default;
+    AssetHandle(std::nullptr_t) { }
+
+    // Wraps a resource that is already resident.
+    AssetHandle(std::shared_ptr<T> resource)
+    {
+        if (resource) {
+            state = std::make_shared<State>();
+            state->resource = std::move(resource);
+        }
+    }
+
+    explicit AssetHandle(std::shared_ptr<State> state)
+        : state { std::move(state) }
+    {
+    }
+
+    T* get() const
+    {
+        if (!state) {
+            return nullptr;
+        }
+        return state->resource ? state->resource.get() : state->placeholder.get();
+    }
+
+    // Same object as get(), as an owning reference.
+    std::shared_ptr<T> share() const
+    {
+        if (!state) {
+            return nullptr;
+        }
+        return state->resource ? state->resource : state->placeholder;
+    }
+
+    T* operator->() const { return get(); }
+    T& operator*() const { return *get(); }
+    explicit operator bool() const { return get() != nullptr; }
+    bool operator==(std::nullptr_t) const { return get() == nullptr; }
+    bool operator!=(std::nullptr_t) const { return get() != nullptr; }
+
+    bool isReady() const { return state && state->resource; }
+    bool hasFailed() const { return state && state->failed; }
+
+private:
+    std::shared_ptr<State> state;
+};
+} // namespace fte
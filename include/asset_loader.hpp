@@ -0,0 +1,70 @@
+#pragma once
+
+#include "asset_handle.hpp"
+#include "device.hpp"
+#include "geometry_pool.hpp"
+#include "model.hpp"
+#include "texture.hpp"
+#include "thread_pool.hpp"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fte {
+// Streams models and textures in the background. Parsing, mesh processing and image
+// decoding run on the thread pool; update() then creates the GPU objects on the main
+// thread and publishes each one to its handles once its upload has completed.
+// Requests for the same file share one load.
+class AssetLoader {
+public:
+    AssetLoader(Device& device, GeometryPool& geometryPool, ThreadPool& threadPool = ThreadPool::shared());
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    AssetHandle<Model> loadModel(const std::string& filepath, Model::VertexFormat format = Model::VertexFormat::Full);
+    // Compression is dropped on devices without textureCompressionBC.
+    AssetHandle<Texture> loadTexture(const std::string& filepath,
+        Texture::Compression compression = Texture::Compression::None);
+
+    // Call once per frame from the main thread.
+    void update();
+
+    size_t getPendingCount() const { return pendingModels.size() + pendingTextures.size(); }
+    // The 1x1 white texture shown while textures stream in.
+    const std::shared_ptr<Texture>& getPlaceholderTexture() const { return placeholderTexture; }
+
+private:
+    template <typename T, typename Source>
+    struct PendingLoad {
+        std::string key;
+        std::future<Source> source;
+        std::shared_ptr<T> resource;
+        std::shared_ptr<typename AssetHandle<T>::State> state;
+        Model::VertexFormat format = Model::VertexFormat::Full;
+    };
+
+    using PendingModel = PendingLoad<Model, Model::Builder>;
+    using PendingTexture = PendingLoad<Texture, Texture::ImageData>;
+
+    template <typename T, typename Source, typename Create>
+    void updatePending(std::vector<PendingLoad<T, Source>>& pending,
+        std::unordered_map<std::string, std::shared_ptr<typename AssetHandle<T>::State>>& loaded, Create create);
+
+    Device& treDevice;
+    GeometryPool& geometryPool;
+    ThreadPool& threadPool;
+
+    std::shared_ptr<Model> placeholderModel;
+    std::shared_ptr<Texture> placeholderTexture;
+
+    std::vector<PendingModel> pendingModels;
+    std::vector<PendingTexture> pendingTextures;
+    std::unordered_map<std::string, std::shared_ptr<AssetHandle<Model>::State>> models;
+    std::unordered_map<std::string, std::shared_ptr<AssetHandle<Texture>::State>> textures;
+};
+} // namespace fte
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "descriptors.hpp"
+#include "device.hpp"
+#include "texture.hpp"
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace fte {
+// One large array of combined image samplers that every draw indexes with a push constant,
+// so objects with different textures are drawn back to back without rebinding descriptor
+// sets. The binding is partially bound, update-after-bind and update-unused-while-pending:
+// a slot is written the first time its texture is drawn, while earlier frames that use the
+// set, but not that slot, may still be in flight.
+class BindlessTextures {
+public:
+    static constexpr uint32_t SET_INDEX = 1;
+    static constexpr uint32_t MAX_TEXTURES = 4096;
+
+    // fallback takes slot 0, which is also where draws without a texture of their own land.
+    BindlessTextures(Device& device, std::shared_ptr<Texture> fallback);
+
+    BindlessTextures(const BindlessTextures&) = delete;
+    BindlessTextures& operator=(const BindlessTextures&) = delete;
+
+    VkDescriptorSetLayout getSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+    // MAX_TEXTURES, clamped to the device's update-after-bind limits.
+    uint32_t getCapacity() const { return capacity; }
+
+    // Array slot of texture, written on first use; slots of destroyed textures are reused.
+    uint32_t getIndex(const std::shared_ptr<Texture>& texture);
+
+private:
+    struct RetiringSlot {
+        uint32_t slot;
+        Timeline::Value retireValue;
+    };
+
+    uint32_t allocateSlot();
+    void retireSlot(uint32_t slot);
+
+    Device& treDevice;
+    uint32_t capacity = MAX_TEXTURES;
+    std::unique_ptr<DescriptorSetLayout> setLayout;
+    std::unique_ptr<DescriptorPool> descriptorPool;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    std::shared_ptr<Texture> fallback;
+    std::vector<std::weak_ptr<Texture>> slots;
+    std::unordered_map<const Texture*, uint32_t> indices;
+    std::deque<RetiringSlot> retiringSlots; // in retire value order
+};
+} // namespace fte
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "texture.hpp"
+#include "thread_pool.hpp"
+
+#include <cstdint>
+
+namespace fte {
+// CPU encoder for textures that arrive as plain RGBA8 (PNGs dropped in by artists).
+// BC1 stores RGB at 4 bits per texel and drops alpha; BC7 (mode 6 only) keeps alpha at
+// 8 bits per texel. The palette search runs four texels at a time with SSE2 when the
+// target has it.
+class BlockCompressor {
+public:
+    enum class Format {
+        BC1,
+        BC7,
+    };
+
+    // Builds the full mip chain from an sRGB RGBA8 image (averaging in linear space) and
+    // encodes every level; block rows are spread over threadPool.
+    static Texture::ImageData compress(const Texture::ImageData& image, Format format,
+        ThreadPool& threadPool = ThreadPool::shared());
+
+    // rgba points at 16 texels, row by row.
+    static void encodeBC1Block(const uint8_t* rgba, uint8_t* block);
+    static void encodeBC7Block(const uint8_t* rgba, uint8_t* block);
+};
+} // namespace fte
@@ -21,12 +21,19 @@ class Buffer {
   VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
   void unmap();
 
-  void writeToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+  // Copies only [offset, offset + size) and marks it dirty, so partial updates of large
+  // buffers cost what they write. Offsets are relative to the mapped range.
+  void writeToBuffer(const void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+  // Queues a range written through getMappedMemory() for the batched per-frame flush
+  // (MemoryAllocator::flushMappedRanges). Offsets are from the start of the buffer, as
+  // for flush(). Free for host-coherent memory.
+  void markDirty(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+  // Flushes immediately, for writes the GPU reads before the next frame is submitted.
   VkResult flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
   VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
   VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
-  void writeToIndex(void* data, int index);
+  void writeToIndex(const void* data, int index);
   VkResult flushIndex(int index);
   VkDescriptorBufferInfo descriptorInfoForIndex(int index);
   VkResult invalidateIndex(int index);
@@ -45,8 +52,9 @@ class Buffer {
 
   Device& treDevice;
   void* mapped = nullptr;
+  VkDeviceSize mappedOffset = 0;
   VkBuffer buffer = VK_NULL_HANDLE;
-  VkDeviceMemory memory = VK_NULL_HANDLE;
+  MemoryAllocator::Allocation allocation{};
 
   VkDeviceSize bufferSize;
   uint32_t instanceCount;
@@ -15,20 +15,26 @@ class DescriptorSetLayout {
    public:
     Builder(Device &treDevice) : treDevice{treDevice} {}
 
+    // bindingFlags are VkDescriptorBindingFlags (descriptor indexing); any
+    // UPDATE_AFTER_BIND binding makes the layout require an update-after-bind pool.
     Builder &addBinding(
         uint32_t binding,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count = 1);
+        uint32_t count = 1,
+        VkDescriptorBindingFlags bindingFlags = 0);
     std::unique_ptr<DescriptorSetLayout> build() const;
 
    private:
     Device &treDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
   };
 
   DescriptorSetLayout(
-      Device &treDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      Device &treDevice,
+      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags = {});
   ~DescriptorSetLayout();
   DescriptorSetLayout(const DescriptorSetLayout &) = delete;
   DescriptorSetLayout &operator=(const DescriptorSetLayout &) = delete;
@@ -89,7 +95,9 @@ class DescriptorWriter {
   DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool);
 
   DescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
-  DescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+  // arrayElement selects one slot of an arrayed binding, e.g. a bindless texture.
+  DescriptorWriter &writeImage(
+      uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement = 0);
 
   bool build(VkDescriptorSet &set);
   void overwrite(VkDescriptorSet &set);
@@ -1,14 +1,23 @@
 #pragma once
 
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <SDL3/SDL_vulkan.h>
 
+#include "memory_allocator.hpp"
+#include "timeline.hpp"
 #include "window.hpp"
 
 namespace fte
 {
+class SamplerCache;
+class TextureCache;
+class UploadManager;
+
 struct SwapchainSupportInfo
 {
     VkSurfaceCapabilitiesKHR capabilities;
@@ -20,6 +29,10 @@ struct QueueFamilies
 {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    // graphicsFamily unless the device has a family without graphics for this work:
+    // transfer-only (usually a DMA engine) and compute-capable (async compute).
+    uint32_t transferFamily = 0;
+    uint32_t computeFamily = 0;
     bool hasGraphicsFamily = false;
     bool hasPresentFamily = false;
 
@@ -27,6 +40,30 @@ struct QueueFamilies
     {
         return hasGraphicsFamily && hasPresentFamily;
     }
+
+    bool hasDedicatedTransferFamily() const { return transferFamily != graphicsFamily; }
+    bool hasDedicatedComputeFamily() const { return computeFamily != graphicsFamily; }
+};
+
+// One Vulkan memory heap, as seen by the driver and by the MemoryAllocator.
+struct MemoryHeapBudget
+{
+    VkDeviceSize size;
+    // How much this process can use before the driver starts evicting or failing
+    // allocations, and how much it uses now. Without VK_EXT_memory_budget these are
+    // estimated: 80% of the heap and what the MemoryAllocator has reserved.
+    VkDeviceSize budget;
+    VkDeviceSize usage;
+    VkDeviceSize reserved; // VkDeviceMemory held by the MemoryAllocator
+    VkDeviceSize used;     // the part of reserved handed out to resources
+    bool deviceLocal;
+};
+
+struct MemoryBudget
+{
+    std::vector<MemoryHeapBudget> heaps;
+    MemoryAllocator::Statistics statistics;
+    bool fromDriver; // VK_EXT_memory_budget was available
 };
 
 #ifdef NDEBUG
@@ -52,9 +89,36 @@ public:
     VkSurfaceKHR getSurface() const { return surface; }
     VkQueue getGraphicsQueue() const { return graphicsQueue; }
     VkQueue getPresentQueue() const { return presentQueue; }
+    // The graphics queue on devices without a dedicated family; check QueueFamilies.
+    VkQueue getTransferQueue() const { return transferQueue; }
+    VkQueue getComputeQueue() const { return computeQueue; }
+    MemoryAllocator &getMemoryAllocator() { return *memoryAllocator; }
+    UploadManager &getUploadManager() { return *uploadManager; }
+    // Signaled by every graphics queue submission; see Timeline.
+    Timeline &getGraphicsTimeline() { return *graphicsTimeline; }
+    // Same object as getGraphicsTimeline() when the queue is the graphics queue.
+    Timeline &getTransferTimeline() { return transferTimeline ? *transferTimeline : *graphicsTimeline; }
+    Timeline &getComputeTimeline() { return computeTimeline ? *computeTimeline : *graphicsTimeline; }
+    SamplerCache &getSamplerCache() { return *samplerCache; }
+    TextureCache &getTextureCache() { return *textureCache; }
 
     VkSampleCountFlagBits getMaxUsableSampleCount() const;
 
+    // Cheap enough to poll every frame; streaming code can compare usage to budget.
+    MemoryBudget getMemoryBudget() const;
+    // One line per call: usage against budget per heap, then usage per category.
+    void logMemoryBudget() const;
+
+    // Runs destroy once every graphics submission made so far has completed, for resources
+    // that frames in flight may still read. Never blocks. Main thread only.
+    void deferDestroy(std::function<void()> destroy);
+    // Runs the deferred destroys whose submissions have completed; the renderer calls it
+    // every frame.
+    void retireDeferredDestroys();
+    // Waits for and runs every deferred destroy, for owners of resources that the queued
+    // destroys reference, before they go away.
+    void flushDeferredDestroys();
+
     SwapchainSupportInfo getSwapchainSupport() { return querySwapchainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     QueueFamilies findQueueFamilies() { return findQueueFamilies(physicalDevice); }
@@ -63,15 +127,21 @@ public:
                                  VkImageTiling tiling,
                                  VkFormatFeatureFlags features);
 
+    // Memory comes from the MemoryAllocator; release it there after destroying the resource.
+    // Its accounting category is derived from the usage flags.
     void createBuffer(VkDeviceSize size,
                       VkBufferUsageFlags usage,
                       VkMemoryPropertyFlags properties,
                       VkBuffer& buffer,
-                      VkDeviceMemory& bufferMemory);
+                      MemoryAllocator::Allocation& bufferAllocation);
 
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    void copyBuffer(VkBuffer srcBuffer,
+                    VkBuffer dstBuffer,
+                    VkDeviceSize size,
+                    VkDeviceSize srcOffset = 0,
+                    VkDeviceSize dstOffset = 0);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
     void createImage(uint32_t width,
@@ -83,10 +153,13 @@ public:
                      VkImageUsageFlags usage,
                      VkMemoryPropertyFlags properties,
                      VkImage& image,
-                     VkDeviceMemory& imageMemory,
-                     const VkImageCreateInfo* customImageInfo = nullptr);
+                     MemoryAllocator::Allocation& imageAllocation,
+                     const VkImageCreateInfo* customImageInfo = nullptr,
+                     MemoryAllocator::Pool pool = MemoryAllocator::Pool::General);
 
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+    VkPhysicalDeviceVulkan12Features enabledVulkan12Features = {};
 
 private:
     void createInstance();
@@ -104,7 +177,9 @@ private:
     SwapchainSupportInfo querySwapchainSupport(VkPhysicalDevice device);
     int ratePhysicalDeviceSuitability(VkPhysicalDevice device);
     bool isPhysicalDeviceSuitable(VkPhysicalDevice device);
+    bool supportsBindlessTextures(VkPhysicalDevice device);
     bool checkPhysicalDeviceExtensionSupport(VkPhysicalDevice device);
+    bool isDeviceExtensionSupported(const char* name) const;
     QueueFamilies findQueueFamilies(VkPhysicalDevice device) const;
     std::string physicalDeviceTypeToString(VkPhysicalDeviceType type) const;
 
@@ -116,9 +191,27 @@ private:
     VkSurfaceKHR surface;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    bool memoryBudgetSupported = false;
     VkDevice logicalDevice;
     VkCommandPool commandPool;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;
+    VkQueue computeQueue;
+
+    std::unique_ptr<MemoryAllocator> memoryAllocator;
+    std::unique_ptr<Timeline> graphicsTimeline;
+    std::unique_ptr<Timeline> transferTimeline;
+    std::unique_ptr<Timeline> computeTimeline;
+    std::unique_ptr<UploadManager> uploadManager;
+    std::unique_ptr<SamplerCache> samplerCache;
+    std::unique_ptr<TextureCache> textureCache;
+
+    struct DeferredDestroy
+    {
+        Timeline::Value retireValue;
+        std::function<void()> destroy;
+    };
+    std::deque<DeferredDestroy> deferredDestroys; // in submission order
 };
 } // namespace lre
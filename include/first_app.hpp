@@ -1,8 +1,11 @@
 #pragma once
 
+#include "asset_loader.hpp"
+#include "bindless_textures.hpp"
 #include "descriptors.hpp"
 #include "device.hpp"
 #include "game_object.hpp"
+#include "geometry_pool.hpp"
 #include "renderer.hpp"
 #include "window.hpp"
 
@@ -23,9 +26,14 @@ class FirstApp
     void run();
 
   private:
+    void reportFailedAssets();
+
     Window window{320, 240, "Fast Little Game Engine"};
     Device device{window};
+    GeometryPool geometryPool{device};
+    AssetLoader assetLoader{device, geometryPool};
     Renderer renderer{window, device};
+    BindlessTextures bindlessTextures{device, assetLoader.getPlaceholderTexture()};
 
     std::unique_ptr<DescriptorPool> globalDescriptorPool{};
     GameObject::Map gameObjects;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "device.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace fte {
+// Persistently mapped ring with one region per frame in flight. Per-frame data (uniforms,
+// indirect commands, ...) is bump-allocated from the current frame's region and bound
+// through dynamic descriptor offsets, so it costs no Buffer or descriptor set of its own.
+// A region is rewound by beginFrame once that frame's timeline value is reached, and the
+// frame's writes join the renderer's single batched flush. Content-sized data such as
+// per-meshlet draw commands may outgrow a region; it then spills into overflow blocks
+// that stay with the frame for reuse. Owned by the Renderer.
+class FrameAllocator {
+public:
+    struct Allocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0; // from the start of buffer, i.e. the dynamic offset
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+
+        uint32_t getDynamicOffset() const { return static_cast<uint32_t>(offset); }
+    };
+
+    static constexpr VkDeviceSize DEFAULT_FRAME_CAPACITY = 4ull << 20;
+
+    FrameAllocator(Device& device, uint32_t frameCount, VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY);
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    void beginFrame(uint32_t frameIndex);
+    // alignment 0 means minUniformBufferOffsetAlignment. Once the frame's region is full the
+    // allocation comes from an overflow block, i.e. another buffer: data bound through a
+    // dynamic offset into getBuffer() must be allocated before content-sized data.
+    Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+    Allocation push(const void* data, VkDeviceSize size, VkDeviceSize alignment = 0);
+    template <typename T>
+    Allocation push(const T& data) { return push(&data, sizeof(T)); }
+    // Marks everything allocated since the last call dirty, for
+    // MemoryAllocator::flushMappedRanges.
+    void flush();
+
+    VkBuffer getBuffer() const { return buffer->getBuffer(); }
+    VkDeviceSize getFrameCapacity() const { return frameCapacity; }
+    // For VK_DESCRIPTOR_TYPE_*_BUFFER_DYNAMIC bindings; range is the size the shader reads.
+    VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const { return { getBuffer(), 0, range }; }
+
+private:
+    struct OverflowBlock {
+        std::unique_ptr<Buffer> buffer;
+        VkDeviceSize head = 0;
+        VkDeviceSize flushedHead = 0;
+    };
+
+    Allocation allocateOverflow(VkDeviceSize size, VkDeviceSize alignment);
+    std::unique_ptr<Buffer> createBuffer(VkDeviceSize size, uint32_t instanceCount);
+
+    Device& treDevice;
+    VkDeviceSize frameCapacity;
+    VkDeviceSize uniformAlignment;
+    std::unique_ptr<Buffer> buffer;
+
+    VkDeviceSize frameStart = 0;
+    VkDeviceSize head = 0; // relative to frameStart
+    VkDeviceSize flushedHead = 0;
+
+    std::vector<std::vector<OverflowBlock>> overflowBlocks; // per frame
+    uint32_t frameIndex = 0;
+    size_t overflowBlock = 0; // first block of the frame that may still have room
+};
+} // namespace fte
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "device.hpp"
+
+#include <vector>
+
+namespace fte {
+// Command recording state of one frame in flight. The main thread's primary command
+// buffers and each recording slot's secondary ones come from separate transient command
+// pools, so slots can record concurrently. Buffers are never reset or freed one by one:
+// reset() rewinds every pool with vkResetCommandPool once the frame's timeline value is
+// reached, and later allocations reuse the buffers already allocated. Owned by the Renderer.
+class FrameContext {
+public:
+    FrameContext(Device& device, uint32_t recordingSlotCount);
+    ~FrameContext();
+
+    FrameContext(const FrameContext&) = delete;
+    FrameContext& operator=(const FrameContext&) = delete;
+
+    // Only once the frame's previous submission has completed.
+    void reset();
+
+    // Main thread only.
+    VkCommandBuffer allocatePrimary();
+    // Safe to call concurrently for different slots.
+    VkCommandBuffer allocateSecondary(uint32_t slot);
+
+    uint32_t getRecordingSlotCount() const { return static_cast<uint32_t>(recordingPools.size()); }
+
+private:
+    struct CommandPool {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t usedCount = 0;
+    };
+
+    void createPool(CommandPool& pool);
+    VkCommandBuffer allocate(CommandPool& pool, VkCommandBufferLevel level);
+    void resetPool(CommandPool& pool);
+
+    Device& treDevice;
+    CommandPool mainPool;
+    std::vector<CommandPool> recordingPools;
+};
+} // namespace fte
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "camera.hpp"
+#include "frame_allocator.hpp"
 #include "game_object.hpp"
 
 #include <vulkan/vulkan.h>
@@ -23,6 +24,8 @@ struct FrameInfo {
     VkCommandBuffer commandBuffer;
     Camera& camera;
     VkDescriptorSet globalDescriptorSet;
+    uint32_t globalUboOffset; // dynamic offset of this frame's GlobalUbo
+    FrameAllocator& frameAllocator;
     GameObject::Map& gameObjects;
 };
 } // namespace tre
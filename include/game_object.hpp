@@ -1,5 +1,6 @@
 #pragma once
 
+#include "asset_handle.hpp"
 #include "model.hpp"
 #include "texture.hpp"
 
@@ -63,7 +64,9 @@ class GameObject
     glm::vec3 color{};
     TransformComponent transform = {};
 
-    std::shared_ptr<Model> model;
+    AssetHandle<Model> model;
+    // Sampled through BindlessTextures; without one the object uses its fallback slot.
+    AssetHandle<Texture> texture;
 
   private:
     GameObject(id_t objId) : id{objId}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "upload_manager.hpp"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace fte {
+// Suballocates vertex and index ranges out of a few large device-local buffers, so
+// meshes share allocations and draws only differ in firstIndex/vertexOffset. Every
+// page holds a single element size, which keeps ranges addressable in elements.
+class GeometryPool {
+public:
+    struct Range {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        uint32_t first = 0; // in elements, i.e. vertexOffset or firstIndex
+        uint32_t count = 0;
+        uint32_t elementSize = 0;
+        uint32_t page = 0;
+
+        bool isValid() const { return buffer != VK_NULL_HANDLE; }
+    };
+
+    static constexpr VkDeviceSize DEFAULT_VERTEX_PAGE_SIZE = 64ull << 20;
+    static constexpr VkDeviceSize DEFAULT_INDEX_PAGE_SIZE = 32ull << 20;
+
+    explicit GeometryPool(Device& device,
+        VkDeviceSize vertexPageSize = DEFAULT_VERTEX_PAGE_SIZE,
+        VkDeviceSize indexPageSize = DEFAULT_INDEX_PAGE_SIZE);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    Range allocateVertices(uint32_t vertexSize, uint32_t count);
+    Range allocateIndices(VkIndexType indexType, uint32_t count);
+    // The range is reusable right away; only free it once no frame in flight reads it,
+    // e.g. through Device::deferDestroy.
+    void free(Range& range);
+
+    // Queues a copy of range.count elements into the range on the device's UploadManager.
+    UploadManager::Token upload(const Range& range, const void* data);
+
+    size_t getPageCount() const { return pages.size(); }
+
+private:
+    struct Page {
+        std::unique_ptr<Buffer> buffer;
+        VkBufferUsageFlags usage;
+        uint32_t elementSize;
+        uint32_t capacity;
+        std::map<uint32_t, uint32_t> freeBlocks; // first element -> element count
+    };
+
+    Range allocate(VkBufferUsageFlags usage, uint32_t elementSize, uint32_t count, VkDeviceSize pageSize);
+    static bool allocateFromPage(Page& page, uint32_t count, uint32_t& first);
+
+    Device& treDevice;
+    VkDeviceSize vertexPageSize;
+    VkDeviceSize indexPageSize;
+    std::vector<Page> pages;
+};
+} // namespace fte
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace fte {
+// Reader and writer for the subset of KTX 2.0 the engine ships: one 2D image (no array
+// layers, cube faces or depth), no supercompression, every mip level stored in the file.
+class Ktx2 {
+public:
+    static bool hasIdentifier(const uint8_t* data, size_t size);
+
+    // Block size in bytes and block edge in texels of the formats Texture accepts from
+    // KTX2; returns false for anything else.
+    static bool getFormatBlockInfo(VkFormat format, uint32_t& blockSize, uint32_t& blockExtent);
+
+    using KeyValues = std::map<std::string, std::string>;
+
+    // Throws std::runtime_error if the file is malformed or outside the subset above.
+    // keyValues, if given, receives the string entries of the key/value data.
+    static Texture::ImageData read(const std::string& filePath, KeyValues* keyValues = nullptr);
+
+    // image must carry its levels (as returned by read or BlockCompressor::compress).
+    // Writes through a temporary file; returns false and logs on failure.
+    static bool write(const std::string& filePath, const Texture::ImageData& image, const KeyValues& keyValues = {});
+};
+} // namespace fte
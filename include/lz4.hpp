@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fte {
+// Raw LZ4 block codec (no frame header or checksum), bit-compatible with the reference
+// LZ4_compress_default / LZ4_decompress_safe. Used for archive chunks, which record
+// their own sizes.
+class Lz4 {
+public:
+    static size_t compressBound(size_t size) { return size + size / 255 + 16; }
+
+    // Returns the compressed size, or 0 if the result does not fit in dstCapacity.
+    static size_t compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+    // Fails on malformed input or when the output is not exactly dstSize bytes.
+    static bool decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+};
+} // namespace fte
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "tlsf_allocator.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fte {
+// Suballocates buffers and images out of large VkDeviceMemory blocks instead of one
+// vkAllocateMemory per resource. Each memory type has its own block heaps:
+//  - General: TLSF-managed blocks for long-lived resources.
+//  - Transient: bump-allocated blocks for attachments that are recreated together (depth,
+//    MSAA color); a block rewinds once everything in it has been freed. A new block is
+//    grown to also hold what the previous one holds, and the largest empty block is kept,
+//    so a recreated set of attachments lands in the memory of the one it replaces.
+// Buffers and optimal-tiling images never share a block, which sidesteps
+// bufferImageGranularity. Resources the driver requires dedicated memory for, General
+// resources it prefers dedicated memory for, and General resources larger than half a
+// block get a VkDeviceMemory of their own.
+// Host-visible blocks stay mapped for their whole lifetime; writes to non-coherent
+// memory are queued with markDirty and flushed together by flushMappedRanges. Usage is
+// accounted per category and per Vulkan memory heap (see Statistics). Thread-safe.
+class MemoryAllocator {
+    struct Block;
+
+public:
+    enum class Pool {
+        General,
+        Transient,
+    };
+
+    // What an allocation is for; only used for accounting.
+    enum class Category {
+        Mesh,
+        Texture,
+        Attachment,
+        Staging,
+        Uniform,
+        Other,
+    };
+    static constexpr uint32_t CATEGORY_COUNT = 6;
+    static const char* getCategoryName(Category category);
+
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // Persistent mapping of this allocation's first byte; nullptr unless host-visible.
+        void* mapped = nullptr;
+
+        bool isValid() const { return memory != VK_NULL_HANDLE; }
+
+    private:
+        friend class MemoryAllocator;
+        Block* block = nullptr; // nullptr for dedicated allocations
+        TlsfAllocator::Allocation range {};
+        uint32_t memoryType = 0;
+        Category category = Category::Other;
+    };
+
+    struct Statistics {
+        uint32_t deviceMemoryCount = 0;
+        VkDeviceSize reservedBytes = 0; // sum of all VkDeviceMemory sizes
+        VkDeviceSize usedBytes = 0;
+        VkDeviceSize categoryBytes[CATEGORY_COUNT] {}; // used bytes, indexed by Category
+        // Indexed by Vulkan memory heap.
+        VkDeviceSize heapReservedBytes[VK_MAX_MEMORY_HEAPS] {};
+        VkDeviceSize heapUsedBytes[VK_MAX_MEMORY_HEAPS] {};
+    };
+
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+    static constexpr VkDeviceSize TRANSIENT_BLOCK_SIZE = 32ull << 20;
+
+    MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    // Allocate memory for the resource; the caller binds it at allocation.offset.
+    // VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT is only a preference: without a matching
+    // memory type (most desktop GPUs) the remaining properties are used on their own.
+    Allocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, Pool pool = Pool::General,
+        Category category = Category::Other);
+    Allocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, Pool pool = Pool::General,
+        Category category = Category::Other);
+    // Destroy the resource first. Resets allocation.
+    void free(Allocation& allocation);
+
+    // Queues [offset, offset + size) of a mapped allocation for the next flushMappedRanges,
+    // widened to whole nonCoherentAtomSize atoms. A no-op for host-coherent memory.
+    void markDirty(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    // Flushes every queued range with a single vkFlushMappedMemoryRanges, merging ranges
+    // that touch. The renderer calls this once per frame before submitting.
+    VkResult flushMappedRanges();
+    // Immediate flush and invalidate of part of a mapped allocation, widened like markDirty.
+    // No-ops for host-coherent memory.
+    VkResult flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    VkResult invalidate(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    Statistics getStatistics() const;
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+
+private:
+    struct BlockHeap {
+        uint32_t memoryType = 0;
+        bool transient = false;
+        std::vector<std::unique_ptr<Block>> blocks;
+    };
+
+    Allocation allocate(const VkMemoryRequirements& requirements, bool dedicated,
+        const VkMemoryDedicatedAllocateInfo* dedicatedInfo, VkMemoryPropertyFlags properties,
+        Pool pool, bool optimalImage, Category category);
+    bool allocateFromHeap(uint32_t heapIndex, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+    VkResult allocateMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext,
+        VkDeviceMemory& memory, void*& mapped);
+    void releaseMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType);
+    void track(const Allocation& allocation, bool allocated);
+    bool isCoherent(const Allocation& allocation) const;
+    // [offset, offset + size) of allocation widened to whole nonCoherentAtomSize atoms.
+    VkMappedMemoryRange getAtomRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+    VkDeviceSize getBlockSize(uint32_t memoryType) const;
+
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties {};
+    VkDeviceSize nonCoherentAtomSize = 1;
+
+    mutable std::mutex mutex;
+    // Indexed by (memoryType * 2 + optimalImage) * 2 + transient.
+    std::vector<BlockHeap> heaps;
+    Statistics statistics {};
+    std::vector<VkMappedMemoryRange> dirtyRanges;
+};
+} // namespace fte
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "asset_file_system.hpp"
+#include "model.hpp"
+
+#include <string>
+
+namespace fte {
+// Versioned binary snapshot of a Model::Builder (header, vertex, index, meshlet and LOD blobs)
+// that is mapped straight into memory instead of being reparsed.
+class MeshCache {
+public:
+    static constexpr uint32_t MAGIC = 0x4D455446; // "FTEM"
+    static constexpr uint32_t VERSION = 5;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexStride;
+        uint32_t indexStride;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t meshletStride;
+        uint32_t meshletCount;
+        uint32_t lodStride;
+        uint32_t lodCount;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t meshletOffset;
+        uint64_t lodOffset;
+        uint64_t fileSize;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        int64_t sourceMtime; // std::filesystem::file_time_type ticks, compared before sourceHash
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    MeshCache() = default;
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    static std::string cachePathFor(const std::string& sourcePath) { return sourcePath + ".ftemesh"; }
+
+    static bool write(const std::string& cachePath, const Model::Builder& builder,
+        uint64_t sourceHash, uint64_t sourceSize, int64_t sourceMtime);
+    // Records a new source mtime once the source has been rehashed and found unchanged, so
+    // a touched file is not rehashed on every launch. Best effort: failure only costs a rehash.
+    static void updateSourceMtime(const std::string& cachePath, int64_t sourceMtime);
+
+    bool open(const std::string& cachePath);
+
+    const Header& header() const { return *fileHeader; }
+    const Model::Vertex* vertices() const;
+    const uint32_t* indices() const;
+    const Model::Meshlet* meshlets() const;
+    const Model::Lod* lods() const;
+    uint32_t vertexCount() const { return fileHeader->vertexCount; }
+    uint32_t indexCount() const { return fileHeader->indexCount; }
+    uint32_t meshletCount() const { return fileHeader->meshletCount; }
+    uint32_t lodCount() const { return fileHeader->lodCount; }
+
+private:
+    AssetFile file;
+    const Header* fileHeader = nullptr;
+};
+} // namespace fte
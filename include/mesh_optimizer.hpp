@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fte {
+// Index/vertex reordering passes applied to imported meshes. All passes work on
+// triangle lists and keep the set of triangles (and their winding) unchanged.
+class MeshOptimizer {
+public:
+    struct VertexCacheStatistics {
+        uint32_t vertexTransforms = 0;
+        float acmr = 0.0f; // transformed vertices per triangle (0.5 is the ideal)
+        float atvr = 0.0f; // transformed vertices per unique vertex (1.0 is the ideal)
+    };
+
+    // A contiguous range of the index buffer with culling bounds. The cluster is back
+    // facing for a viewer at p when
+    //   dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius
+    struct Meshlet {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float radius = 0.0f;
+        float coneAxis[3] = { 0.0f, 0.0f, 0.0f };
+        float coneCutoff = 1.0f; // 1 disables cone culling
+    };
+
+    // Simulates a FIFO post-transform cache of cacheSize entries.
+    static VertexCacheStatistics analyzeVertexCache(
+        const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+    // Forsyth's linear-speed vertex cache optimization; reorders triangles in place.
+    static void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // Splits the cache-optimized order into clusters at cache restarts and sorts them
+    // front-to-back from the outside in, so that outer surfaces occlude inner ones.
+    // The result is rejected if it makes ACMR worse than threshold times the input.
+    static void optimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions,
+        size_t vertexCount, size_t positionStride, float threshold = 1.05f);
+
+    // Builds a remap table that orders vertices by first use in the index buffer.
+    // Unreferenced vertices map to ~0u. Returns the number of referenced vertices.
+    static size_t optimizeVertexFetchRemap(
+        std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // Groups triangles into meshlets of at most maxVertices unique vertices and
+    // maxTriangles triangles, growing each one through shared vertices. Indices are
+    // reordered in place so every meshlet is a contiguous range.
+    static std::vector<Meshlet> buildMeshlets(uint32_t* indices, size_t indexCount, const float* positions,
+        size_t vertexCount, size_t positionStride, uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+
+    // Quadric error edge collapse towards targetIndexCount indices into destination (which
+    // must hold indexCount entries); returns the new index count. Vertices are only
+    // moved onto existing ones, so the result indexes the same vertex buffer. Border and
+    // attribute seam vertices stay put, and no collapse may exceed targetError (in
+    // position units), which can leave the result above the target. resultError
+    // receives the largest error introduced.
+    static size_t simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions,
+        size_t vertexCount, size_t positionStride, size_t targetIndexCount, float targetError,
+        float* resultError = nullptr);
+};
+} // namespace fte
@@ -1,7 +1,8 @@
 #pragma once
 
-#include "buffer.hpp"
 #include "device.hpp"
+#include "geometry_pool.hpp"
+#include "mesh_optimizer.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -11,6 +12,8 @@
 #include <vector>
 
 namespace fte {
+class MeshCache;
+
 class Model {
 public:
     struct Vertex {
@@ -28,36 +31,113 @@ public:
         }
     };
 
+    // 16-byte layout: position quantized to the mesh bounds (dequantized through the
+    // model matrix, see getPositionDequantization), octahedral normal, half-float uv.
+    // There is no color stream; shaders treat it as white.
+    struct PackedVertex {
+        uint16_t position[4] {};
+        int16_t normal[2] {};
+        uint16_t uv[2] {};
+
+        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    };
+
+    enum class VertexFormat {
+        Full,
+        Packed,
+    };
+
+    using Meshlet = MeshOptimizer::Meshlet;
+
+    // A simplified copy of the mesh stored after the previous level in the index buffer.
+    struct Lod {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        float error = 0.0f; // geometric deviation relative to the bounding radius
+    };
+
     struct Builder {
+        struct OptimizationReport {
+            MeshOptimizer::VertexCacheStatistics before {};
+            MeshOptimizer::VertexCacheStatistics after {};
+        };
+
         std::vector<Vertex> vertices {};
         std::vector<uint32_t> indices {};
+        std::vector<Meshlet> meshlets {};
+        std::vector<Lod> lods {};
 
+        // Same cache-or-build path as createModelFromFile, minus the GPU work, so it can
+        // run off the main thread.
+        void loadFromFile(const std::string& filepath);
+
+        // Call in this order; optimize() reorders the whole index buffer, the others only
+        // touch or append to the LOD 0 range.
         void loadModel(const std::string& filepath);
+        OptimizationReport optimize(bool reorderForOverdraw = true);
+        void buildMeshlets();
+        // Appends up to maxLodCount - 1 simplified levels, each about half the previous.
+        void buildLods(uint32_t maxLodCount = 5);
     };
 
-    Model(Device& device, const Model::Builder& builder);
+    Model(Device& device, GeometryPool& geometryPool, const Model::Builder& builder,
+        VertexFormat format = VertexFormat::Full);
+    Model(Device& device, GeometryPool& geometryPool, const MeshCache& cache,
+        VertexFormat format = VertexFormat::Full);
     ~Model();
 
     Model(const Model&) = delete;
     Model& operator=(const Model&) = delete;
 
-    static std::unique_ptr<Model> createModelFromFile(
-        Device& device, const std::string& filepath);
+    static std::unique_ptr<Model> createModelFromFile(Device& device, GeometryPool& geometryPool,
+        const std::string& filepath, VertexFormat format = VertexFormat::Full);
 
     void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
+    void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+    // Draws drawCount VkDrawIndexedIndirectCommand records, typically visible meshlet ranges.
+    void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount);
+
+    VertexFormat getVertexFormat() const { return vertexFormat; }
+    // Maps packed positions back to model space; identity for VertexFormat::Full.
+    const glm::mat4& getPositionDequantization() const { return positionDequantization; }
+    VkIndexType getIndexType() const { return indexType; }
+    // Models share pool buffers; draws with equal buffers need no rebind in between.
+    VkBuffer getVertexBuffer() const { return vertexRange.buffer; }
+    VkBuffer getIndexBuffer() const { return indexRange.buffer; }
+    uint32_t getFirstIndex() const { return indexRange.first; }
+    int32_t getVertexOffset() const { return static_cast<int32_t>(vertexRange.first); }
+    // Completes once the geometry has reached the GPU; draws may be recorded before that.
+    UploadManager::Token getUploadToken() const { return uploadToken; }
+    // Bounds are in model space, before getPositionDequantization.
+    const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+    const std::vector<Lod>& getLods() const { return lods; }
+    const glm::vec3& getBoundingCenter() const { return boundingCenter; }
+    float getBoundingRadius() const { return boundingRadius; }
 
 private:
-    void createVertexBuffers(const std::vector<Vertex>& vertices);
-    void createIndexBuffers(const std::vector<uint32_t>& indices);
+    void createVertexBuffers(const Vertex* vertices, uint32_t count);
+    void uploadVertexBuffer(const void* vertices, uint32_t vertexSize, uint32_t count);
+    void createIndexBuffers(const uint32_t* indices, uint32_t count);
 
     Device& treDevice;
+    GeometryPool& geometryPool;
+
+    VertexFormat vertexFormat;
+    glm::mat4 positionDequantization { 1.0f };
+    glm::vec3 boundingCenter { 0.0f };
+    float boundingRadius = 0.0f;
 
-    std::unique_ptr<Buffer> vertexBuffer;
+    GeometryPool::Range vertexRange {};
     uint32_t vertexCount;
 
     bool hasIndexBuffer = false;
-    std::unique_ptr<Buffer> indexBuffer;
+    GeometryPool::Range indexRange {};
+    UploadManager::Token uploadToken = 0;
     uint32_t indexCount;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+    std::vector<Meshlet> meshlets;
+    std::vector<Lod> lods;
 };
 } // namespace tre
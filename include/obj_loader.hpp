@@ -0,0 +1,28 @@
+#pragma once
+
+#include "thread_pool.hpp"
+
+#include <string>
+#include <vector>
+
+namespace fte {
+// Parallel Wavefront OBJ importer. Produces the same attribute and (triangulated)
+// index streams as tinyobj::LoadObj with all shapes concatenated in file order.
+class ObjLoader {
+public:
+    struct Index {
+        int vertexIndex;
+        int normalIndex;
+        int texcoordIndex;
+    };
+
+    struct Mesh {
+        std::vector<float> positions {};
+        std::vector<float> normals {};
+        std::vector<float> texcoords {};
+        std::vector<Index> indices {};
+    };
+
+    static Mesh load(const std::string& filepath, ThreadPool& pool = ThreadPool::shared());
+};
+} // namespace fte
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "device.hpp"
+#include "frame_allocator.hpp"
+#include "frame_context.hpp"
 #include "swap_chain.hpp"
 #include "window.hpp"
 
@@ -14,7 +16,6 @@ namespace fte
     {
     public:
         Renderer(Window &window, Device &device);
-        ~Renderer();
 
         Renderer(const Renderer &) = delete;
         Renderer &operator=(const Renderer &) = delete;
@@ -26,7 +27,7 @@ namespace fte
         VkCommandBuffer getCurrentCommandBuffer() const
         {
             assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
-            return commandBuffers[currentFrameIndex];
+            return currentCommandBuffer;
         }
 
         int getFrameIndex() const
@@ -35,20 +36,40 @@ namespace fte
             return currentFrameIndex;
         }
 
+        // Rewound for the current frame by beginFrame and flushed by endFrame before submitting.
+        FrameAllocator &getFrameAllocator() { return frameAllocator; }
+
         VkCommandBuffer beginFrame();
         void endFrame();
-        void beginSwapchainRenderPass(VkCommandBuffer commandBuffer);
+        // Pass VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS to fill the render pass with
+        // executeSecondaryCommandBuffers instead of inline commands.
+        void beginSwapchainRenderPass(VkCommandBuffer commandBuffer,
+                                      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
         void endSwapchainRenderPass(VkCommandBuffer commandBuffer);
 
+        // Secondary command buffers for recording the swapchain render pass on worker
+        // threads. Every slot has its own command pool in each FrameContext, so different
+        // slots may record concurrently; one slot must not be used by two threads at once.
+        // Viewport and scissor are already set.
+        uint32_t getRecordingSlotCount() const { return recordingSlotCount; }
+        VkCommandBuffer beginSecondaryCommandBuffer(uint32_t slot);
+        // Ends the buffers and executes them in order inside the render pass.
+        void executeSecondaryCommandBuffers(VkCommandBuffer commandBuffer,
+                                            const std::vector<VkCommandBuffer> &secondaryCommandBuffers);
+
     private:
-        void createCommandBuffers();
-        void freeCommandBuffers();
+        void setViewportAndScissor(VkCommandBuffer commandBuffer);
         void recreateSwapchain();
 
         Window &window;
         Device &device;
         std::unique_ptr<Swapchain> swapchain;
-        std::vector<VkCommandBuffer> commandBuffers;
+        FrameAllocator frameAllocator;
+        uint32_t recordingSlotCount;
+        // One per frame in flight; beginFrame resets the current one and takes its
+        // primary command buffer from it.
+        std::vector<std::unique_ptr<FrameContext>> frameContexts;
+        VkCommandBuffer currentCommandBuffer = VK_NULL_HANDLE;
 
         uint32_t currentImageIndex;
         int currentFrameIndex{0};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+namespace fte {
+class Device;
+
+// One VkSampler per distinct VkSamplerCreateInfo, handed out as reference-counted handles.
+// A sampler is destroyed with its last handle and recreated on the next request, so the
+// live count stays bounded by the number of configurations actually in use
+// (maxSamplerAllocationCount). Used from the main thread only.
+class SamplerCache {
+public:
+    using Handle = std::shared_ptr<const VkSampler>;
+
+    explicit SamplerCache(Device& device);
+
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    // createInfo.pNext must be null; extension structs are not part of the key.
+    Handle get(const VkSamplerCreateInfo& createInfo);
+
+    size_t getSamplerCount() const;
+
+private:
+    struct Key {
+        VkSamplerCreateFlags flags;
+        VkFilter magFilter;
+        VkFilter minFilter;
+        VkSamplerMipmapMode mipmapMode;
+        VkSamplerAddressMode addressModeU;
+        VkSamplerAddressMode addressModeV;
+        VkSamplerAddressMode addressModeW;
+        float mipLodBias;
+        VkBool32 anisotropyEnable;
+        float maxAnisotropy;
+        VkBool32 compareEnable;
+        VkCompareOp compareOp;
+        float minLod;
+        float maxLod;
+        VkBorderColor borderColor;
+        VkBool32 unnormalizedCoordinates;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    Device& treDevice;
+    std::unordered_map<Key, std::weak_ptr<const VkSampler>, KeyHash> samplers;
+};
+} // namespace fte
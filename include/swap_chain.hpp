@@ -52,6 +52,7 @@ private:
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
     void createDepthResources();
     void createColorResources();
+    void destroyAttachments();
     void createRenderPass();
     void createFramebuffers();
     void createSyncObjects();
@@ -69,13 +70,15 @@ private:
     std::vector<VkFramebuffer> swapchainFramebuffers;
     VkRenderPass renderPass;
 
-    std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
-    std::vector<VkImageView> depthImageViews;
+    // The multisampled attachments never outlive a render pass, so every framebuffer
+    // shares one of each; the render pass dependency orders frames writing to them.
+    VkImage depthImage = VK_NULL_HANDLE;
+    MemoryAllocator::Allocation depthImageAllocation {};
+    VkImageView depthImageView = VK_NULL_HANDLE;
 
-    std::vector<VkImage> colorImages;
-    std::vector<VkDeviceMemory> colorImageMemorys;
-    std::vector<VkImageView> colorImageViews;
+    VkImage colorImage = VK_NULL_HANDLE;
+    MemoryAllocator::Allocation colorImageAllocation {};
+    VkImageView colorImageView = VK_NULL_HANDLE;
 
     std::vector<VkImage> swapchainImages;
     std::vector<VkImageView> swapchainImageViews;
@@ -88,8 +91,9 @@ private:
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
+    // Graphics timeline values of the last submission per frame slot and per image.
+    std::vector<Timeline::Value> frameValues;
+    std::vector<Timeline::Value> imageValues;
     size_t currentFrame = 0;
 };
 } // namespace tre
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "bindless_textures.hpp"
 #include "camera.hpp"
 #include "device.hpp"
 #include "frame_info.hpp"
 #include "game_object.hpp"
 #include "pipeline.hpp"
+#include "renderer.hpp"
+#include "swap_chain.hpp"
 
 // std
 #include <memory>
@@ -13,22 +16,61 @@
 namespace fte {
 	class SimpleRenderSystem {
 	public:
-		SimpleRenderSystem(
-			Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+			BindlessTextures& bindlessTextures);
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+		// Culls, selects LODs, sorts the draws and writes their indirect commands. Call once
+		// per frame before recording with either function below.
+		void prepareGameObjects(FrameInfo& frameInfo);
+		// True when there are enough draws to be worth recording on worker threads.
+		bool shouldRecordInParallel() const { return objectDraws.size() >= PARALLEL_RECORDING_THRESHOLD; }
+		// Records the prepared draws into frameInfo.commandBuffer, inside an inline render pass.
 		void renderGameObjects(FrameInfo& frameInfo);
+		// Records the prepared draws on the shared thread pool, in contiguous runs of the
+		// sorted draw list, one secondary command buffer per run. Pass the result, in order,
+		// to Renderer::executeSecondaryCommandBuffers.
+		std::vector<VkCommandBuffer> recordGameObjects(FrameInfo& frameInfo, Renderer& renderer);
+
+		// Normal-cone culling drops clusters facing away from the camera. The pipeline
+		// draws both faces, so turn it off for open meshes whose inside is visible.
+		void setMeshletConeCulling(bool enabled) { meshletConeCulling = enabled; }
 
 	private:
+		static constexpr size_t PARALLEL_RECORDING_THRESHOLD = 1024;
+		// Fewer draws than this per secondary command buffer cost more than they save.
+		static constexpr size_t MIN_DRAWS_PER_RECORDING = 256;
+
+		struct ObjectDraw {
+			GameObject* object;
+			Pipeline* pipeline;
+			uint32_t firstCommand;
+			uint32_t commandCount;
+			uint32_t lod;
+			uint32_t textureIndex;
+		};
+
 		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
 		void createPipeline(VkRenderPass renderPass);
+		void recordDraws(VkCommandBuffer commandBuffer, const FrameInfo& frameInfo, size_t firstDraw, size_t lastDraw);
+		void cullMeshlets(const Model& model, const glm::mat4& modelMatrix, const glm::mat4& viewProjection,
+			const glm::vec3& cameraPosition);
+		uint32_t selectLod(const Model& model, const glm::mat4& modelMatrix, const glm::mat4& projection,
+			const glm::vec3& cameraPosition) const;
 
 		Device& treDevice;
+		BindlessTextures& bindlessTextures;
 
 		std::unique_ptr<Pipeline> trePipeline;
+		std::unique_ptr<Pipeline> packedPipeline;
 		VkPipelineLayout pipelineLayout;
+
+		std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+		std::vector<ObjectDraw> objectDraws;
+		FrameAllocator::Allocation indirectCommands {};
+		bool meshletConeCulling = true;
 	};
 }  // namespace tre
@@ -1,16 +1,51 @@
 #pragma once
 
 #include "device.hpp"
+#include "sampler_cache.hpp"
+#include "upload_manager.hpp"
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
 namespace fte {
 	class Texture {
 	public:
+		// One level of a precomputed mip chain, located inside ImageData::pixels.
+		struct MipLevel {
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+		};
+
+		// Decoded pixels; loading them needs no device, so it can run on any thread.
+		// Without levels, pixels is RGBA8 level 0 and the mips are blitted on the GPU;
+		// with levels (KTX2), pixels holds every level in format and is copied as is.
+		struct ImageData {
+			int width = 0;
+			int height = 0;
+			VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+			std::vector<uint8_t> pixels;
+			std::vector<MipLevel> levels;
+			uint64_t sourceHash = 0; // hash of the file read, 0 if unknown; TextureCache dedupes on it
+		};
+
+		enum class Compression {
+			None,
+			BC1, // RGB only, 4 bits per texel
+			BC7, // RGBA, 8 bits per texel
+		};
+
+		// KTX2 files load as stored. Other images decode to RGBA8 and, unless compression is
+		// None, are block-compressed once and cached next to the source as .bc1.ktx2 or
+		// .bc7.ktx2, tagged with a hash of the source bytes.
+		static ImageData loadImageData(const std::string& filePath, Compression compression = Compression::None);
+
 		Texture(Device& device, const std::string& filePath);
+		Texture(Device& device, const ImageData& imageData);
 		~Texture();
 
 		Texture(const Texture& other) = delete;
@@ -19,25 +54,29 @@ namespace fte {
 		Texture(Texture&& other) = delete;
 		Texture& operator=(Texture&& other) = delete;
 
-		VkSampler getSampler() const { return sampler; }
+		VkSampler getSampler() const { return *sampler; }
 		VkImageView getImageView() const { return imageView; }
 		VkImageLayout getImageLayout() const { return imageLayout; }
+		// Completes once the pixels and mips are on the GPU.
+		UploadManager::Token getUploadToken() const { return uploadToken; }
 
+		// Goes through the device's TextureCache, so repeated calls share one texture.
 		static std::shared_ptr<Texture> createTextureFromFile(Device& device, const std::string& filePath);
 
 	private:
-		void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
-		void generateMipmaps();
+		void transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
+		void generateMipmaps(VkCommandBuffer commandBuffer);
 
 		int width, height, mipLevels;
 
 		Device& device;
 
 		VkImage image;
-		VkDeviceMemory imageMemory;
+		MemoryAllocator::Allocation imageAllocation;
 		VkImageView imageView;
 		VkFormat imageFormat;
 		VkImageLayout imageLayout;
-		VkSampler sampler;
+		SamplerCache::Handle sampler;
+		UploadManager::Token uploadToken = 0;
 	};
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace fte {
+// Shares textures loaded from files. Lookups go by canonical path, so different spellings of
+// one file match, and on a miss by the source file's content hash, so copies of the same
+// image under different names still end up in one VkImage. Only weak references are held;
+// a texture is destroyed with its last shared_ptr. Used from the main thread only.
+class TextureCache {
+public:
+    explicit TextureCache(Device& device);
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Canonical path plus compression; the key find() and create() expect.
+    static std::string makeKey(const std::string& filePath, Texture::Compression compression);
+
+    // The live texture for key, or nullptr.
+    std::shared_ptr<Texture> find(const std::string& key);
+    // Registers a texture for image data loaded from the file behind key, reusing a live one
+    // with the same source hash and format instead of creating another.
+    std::shared_ptr<Texture> create(const std::string& key, const Texture::ImageData& image);
+    // find() or, on a miss, load on the calling thread and create().
+    std::shared_ptr<Texture> load(const std::string& filePath,
+        Texture::Compression compression = Texture::Compression::None);
+
+    size_t getTextureCount() const;
+
+private:
+    void removeExpired();
+
+    Device& treDevice;
+    std::unordered_map<std::string, std::weak_ptr<Texture>> texturesByPath;
+    std::map<std::pair<uint64_t, VkFormat>, std::weak_ptr<Texture>> texturesByContent;
+};
+} // namespace fte
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace fte {
+// A timeline semaphore (core in Vulkan 1.2) that counts the submissions made to one
+// queue. Every submit() signals the next value, so the host can poll or wait for an exact
+// submission instead of a per-submission fence or vkQueueWaitIdle. Values only grow, so
+// a completed value means every earlier submission through this timeline has completed
+// too. Frames, upload batches, deferred deletions and readbacks all wait on these values.
+// Not thread-safe: submit from the thread that owns the queue.
+class Timeline {
+public:
+    using Value = uint64_t;
+
+    explicit Timeline(VkDevice device);
+    ~Timeline();
+
+    Timeline(const Timeline&) = delete;
+    Timeline& operator=(const Timeline&) = delete;
+
+    // Submits with the timeline appended to submitInfo's signal semaphores and returns the
+    // value it will reach. Wait semaphores must be binary. fence may be VK_NULL_HANDLE.
+    Value submit(VkQueue queue, const VkSubmitInfo& submitInfo, VkFence fence = VK_NULL_HANDLE);
+    // Submits commandBuffer so that it starts waitStage only once waitTimeline, typically
+    // another queue's, has reached waitValue. Orders cross-queue work without the host.
+    Value submitAfter(VkQueue queue, VkCommandBuffer commandBuffer, const Timeline& waitTimeline, Value waitValue,
+        VkPipelineStageFlags waitStage);
+
+    VkSemaphore getSemaphore() const { return semaphore; }
+    Value getLastSubmittedValue() const { return lastSubmittedValue; }
+    Value getCompletedValue();
+    // Value 0 is always complete, so a default-initialized Value never blocks.
+    bool isComplete(Value value);
+    void wait(Value value);
+
+private:
+    // waitValues has one entry per wait semaphore, or is null when they are all binary.
+    Value submit(VkQueue queue, const VkSubmitInfo& submitInfo, VkFence fence, const uint64_t* waitValues);
+
+    VkDevice device;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    Value lastSubmittedValue = 0;
+    Value completedValue = 0; // cached; only queried while it is behind the asked value
+};
+} // namespace fte
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace fte {
+// Two-level segregated fit allocator over an abstract [0, size) range: constant-time
+// allocate and free with immediate coalescing. It only hands out offsets; the caller
+// owns whatever memory they index. Not thread-safe.
+class TlsfAllocator {
+public:
+    static constexpr uint32_t INVALID_NODE = ~0u;
+    // Every offset and size is a multiple of this.
+    static constexpr uint64_t GRANULARITY = 16;
+
+    struct Allocation {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t node = INVALID_NODE;
+    };
+
+    explicit TlsfAllocator(uint64_t size);
+
+    TlsfAllocator(const TlsfAllocator&) = delete;
+    TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+
+    // alignment must be a power of two. Returns false when no free range is large enough.
+    bool allocate(uint64_t size, uint64_t alignment, Allocation& allocation);
+    void free(const Allocation& allocation);
+
+    uint64_t getSize() const { return totalSize; }
+    uint64_t getUsedSize() const { return usedSize; }
+    bool isEmpty() const { return usedSize == 0; }
+
+private:
+    static constexpr uint32_t SECOND_LEVEL_LOG2 = 4;
+    static constexpr uint32_t SECOND_LEVEL_COUNT = 1u << SECOND_LEVEL_LOG2;
+    // Size classes start at 2^SECOND_LEVEL_LOG2 == GRANULARITY.
+    static constexpr uint32_t FIRST_LEVEL_COUNT = 64 - SECOND_LEVEL_LOG2;
+
+    struct Node {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t previousPhysical;
+        uint32_t nextPhysical;
+        uint32_t previousFree;
+        uint32_t nextFree;
+        bool free;
+    };
+
+    static void mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+    uint32_t findFree(uint64_t size) const;
+    void insertFree(uint32_t node);
+    void removeFree(uint32_t node);
+    uint32_t createNode(uint64_t offset, uint64_t size);
+    void releaseNode(uint32_t node);
+
+    uint64_t totalSize;
+    uint64_t usedSize = 0;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> unusedNodes;
+    uint64_t firstLevelBitmap = 0;
+    uint32_t secondLevelBitmaps[FIRST_LEVEL_COUNT] {};
+    uint32_t freeHeads[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+};
+} // namespace fte
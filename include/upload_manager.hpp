@@ -0,0 +1,100 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "device.hpp"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace fte {
+// Batches staging copies into one command buffer per submission instead of a
+// vkQueueWaitIdle per copy. Data is staged through a persistently mapped ring buffer;
+// every batch signals the graphics timeline and is identified by a Token that callers
+// can poll or wait on.
+// Each batch ends with a barrier that makes its writes visible to all later work on
+// the graphics queue. With a dedicated transfer queue the copies run there, alongside
+// rendering, and ownership of the written buffers and images moves to the graphics queue
+// through release/acquire barrier pairs. Main thread only.
+class UploadManager {
+public:
+    using Token = uint64_t;
+
+    struct StagingAllocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void* mapped = nullptr;
+    };
+
+    static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 64ull << 20;
+
+    explicit UploadManager(Device& device, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+    ~UploadManager();
+
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+
+    // Reserves staging memory for the open batch. Requests larger than half the ring get
+    // a buffer of their own that lives until the batch completes. A full ring submits the
+    // open batch, so call getCommandBuffer() after staging, not before.
+    StagingAllocation allocateStaging(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    // Open batch command buffer on the transfer queue, for copies from staging memory and
+    // transitions into TRANSFER_DST. Transfer-only queues reject graphics stages and blits.
+    VkCommandBuffer getCommandBuffer();
+    // Open batch command buffer on the graphics queue, for blits and transitions to shader
+    // layouts. Runs after the batch's transfers; getCommandBuffer() without a dedicated queue.
+    VkCommandBuffer getGraphicsCommandBuffer();
+
+    // Moves an image written through getCommandBuffer() to the graphics queue, transitioning
+    // it from oldLayout to newLayout for dstStage/dstAccess. Commands recorded afterwards into
+    // getGraphicsCommandBuffer() may use it.
+    void transferImageToGraphics(VkImage image, const VkImageSubresourceRange& range, VkImageLayout oldLayout,
+        VkImageLayout newLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    Token copyToBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+    // Token the open batch will complete with.
+    Token getCurrentToken() const { return nextToken; }
+
+    // Submits the open batch, if any, without waiting.
+    void flush();
+    bool isComplete(Token token);
+    void wait(Token token);
+
+private:
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE; // only with a dedicated transfer queue
+        Timeline::Value timelineValue = 0; // on the graphics timeline, which also covers the transfers
+        std::vector<VkBufferMemoryBarrier> bufferTransfers; // released together at flush
+        Token token = 0;
+        uint64_t ringEnd = 0;
+        std::vector<std::unique_ptr<Buffer>> oversizedStaging;
+    };
+
+    void beginBatch();
+    VkCommandBuffer allocateCommandBuffer(VkCommandPool pool);
+    void retireCompleted();
+    void retireOldest();
+
+    Device& treDevice;
+    VkCommandPool commandPool = VK_NULL_HANDLE; // transfer family
+    VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+    uint32_t transferFamily;
+    uint32_t graphicsFamily;
+    bool dedicatedTransfer;
+
+    std::unique_ptr<Buffer> stagingRing;
+    uint64_t ringHead = 0; // monotonic byte positions, wrapped modulo the ring size
+    uint64_t ringTail = 0;
+
+    bool hasOpenBatch = false;
+    Batch openBatch {};
+    std::deque<Batch> pendingBatches;
+    std::vector<Batch> freeBatches;
+
+    Token nextToken = 1;
+    Token completedToken = 0;
+};
+} // namespace fte
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace fte {
+// Flat open-addressing table that maps vertices to their index in an output array.
+// Vertices are hashed over their raw 32-bit words and compared with operator==,
+// so -0.0f and 0.0f still weld together like they do with std::hash<float>.
+template <typename Vertex>
+class VertexWeldTable {
+    static_assert(std::is_trivially_copyable_v<Vertex>, "welded vertices must be trivially copyable");
+    static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "welded vertices must be made of 32-bit words");
+
+public:
+    // expectedCount is an upper bound on unique vertices (the index count works).
+    explicit VertexWeldTable(size_t expectedCount)
+    {
+        size_t capacity = 16;
+        while (capacity < expectedCount + expectedCount / 2) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        slots.assign(capacity, EMPTY);
+    }
+
+    // Returns the index of an equal vertex already in vertices, appending it first if
+    // there is none.
+    uint32_t weld(const Vertex& vertex, std::vector<Vertex>& vertices)
+    {
+        if (count + count / 2 >= slots.size()) {
+            grow(vertices);
+        }
+
+        for (size_t slot = hash(vertex) & mask;; slot = (slot + 1) & mask) {
+            uint32_t index = slots[slot];
+            if (index == EMPTY) {
+                index = static_cast<uint32_t>(vertices.size());
+                slots[slot] = index;
+                vertices.push_back(vertex);
+                count++;
+                return index;
+            }
+            if (vertices[index] == vertex) {
+                return index;
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t EMPTY = ~0u;
+    static constexpr size_t WORD_COUNT = sizeof(Vertex) / sizeof(uint32_t);
+
+    static uint64_t hash(const Vertex& vertex)
+    {
+        uint32_t words[WORD_COUNT];
+        std::memcpy(words, &vertex, sizeof(Vertex));
+
+        // Independent per-word multiplies so the loop vectorizes; -0.0f folds onto 0.0f.
+        uint64_t h = 0;
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            uint64_t word = words[i] == 0x80000000u ? 0u : words[i];
+            h += (word + i) * (0x9E3779B97F4A7C15ull + 2 * i);
+        }
+
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    void grow(const std::vector<Vertex>& vertices)
+    {
+        std::vector<uint32_t> previous(slots.size() * 2, EMPTY);
+        previous.swap(slots);
+        mask = slots.size() - 1;
+        for (uint32_t index : previous) {
+            if (index == EMPTY) {
+                continue;
+            }
+            size_t slot = hash(vertices[index]) & mask;
+            while (slots[slot] != EMPTY) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = index;
+        }
+    }
+
+    std::vector<uint32_t> slots;
+    size_t mask = 0;
+    size_t count = 0;
+};
+} // namespace fte
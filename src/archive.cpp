@@ -0,0 +1,310 @@
+#include "archive.hpp"
+
+#include "lz4.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+namespace fte {
+namespace {
+    constexpr uint64_t TABLE_ALIGNMENT = 16;
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    uint32_t chunkCountFor(uint64_t size)
+    {
+        return static_cast<uint32_t>((size + Archive::CHUNK_SIZE - 1) / Archive::CHUNK_SIZE);
+    }
+
+    struct PendingChunk {
+        const uint8_t* source;
+        uint32_t size;
+        std::vector<uint8_t> compressed; // empty when stored verbatim
+    };
+}
+
+uint64_t Archive::hashPath(std::string_view path)
+{
+    return hashBytes(path.data(), path.size());
+}
+
+bool Archive::write(const std::string& archivePath, const FileList& files, bool compress, ThreadPool& threadPool)
+{
+    std::vector<MappedFile> sources(files.size());
+    std::vector<Entry> entries(files.size());
+    std::unordered_set<std::string_view> seenPaths;
+    std::string strings;
+    uint32_t chunkCount = 0;
+
+    for (size_t i = 0; i < files.size(); i++) {
+        const auto& [path, sourcePath] = files[i];
+        if (path.empty() || !seenPaths.insert(path).second) {
+            std::cerr << "invalid or duplicate archive path '" << path << "'" << std::endl;
+            return false;
+        }
+
+        // MappedFile refuses empty files; those become entries without chunks.
+        std::error_code error;
+        if (!sources[i].open(sourcePath) && std::filesystem::file_size(sourcePath, error) != 0) {
+            std::cerr << "failed to read " << sourcePath << std::endl;
+            return false;
+        }
+
+        Entry& entry = entries[i];
+        entry.pathHash = hashPath(path);
+        entry.pathOffset = static_cast<uint32_t>(strings.size());
+        entry.pathLength = static_cast<uint32_t>(path.size());
+        entry.size = sources[i].size();
+        entry.firstChunk = chunkCount;
+        entry.chunkCount = chunkCountFor(entry.size);
+        strings += path;
+        chunkCount += entry.chunkCount;
+    }
+
+    std::vector<PendingChunk> pending;
+    pending.reserve(chunkCount);
+    for (size_t i = 0; i < files.size(); i++) {
+        for (uint32_t c = 0; c < entries[i].chunkCount; c++) {
+            uint64_t offset = uint64_t { c } * CHUNK_SIZE;
+            pending.push_back({ sources[i].data() + offset,
+                static_cast<uint32_t>(std::min<uint64_t>(CHUNK_SIZE, entries[i].size - offset)), {} });
+        }
+    }
+
+    // Keep a chunk compressed only if it saves at least 1/16 of its size, so already
+    // compressed data (PNG, BC blocks) stays directly viewable.
+    if (compress) {
+        threadPool.parallelFor(chunkCount, [&](uint32_t c) {
+            PendingChunk& chunk = pending[c];
+            std::vector<uint8_t> buffer(Lz4::compressBound(chunk.size));
+            size_t compressedSize = Lz4::compress(chunk.source, chunk.size, buffer.data(), buffer.size());
+            if (compressedSize != 0 && compressedSize < chunk.size - chunk.size / 16) {
+                buffer.resize(compressedSize);
+                chunk.compressed = std::move(buffer);
+            }
+        });
+    }
+
+    Header header {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.slotCount = 1;
+    while (header.slotCount < header.entryCount * 2) {
+        header.slotCount *= 2;
+    }
+    header.chunkCount = chunkCount;
+    header.stringsSize = static_cast<uint32_t>(strings.size());
+    header.slotOffset = alignUp(sizeof(Header), TABLE_ALIGNMENT);
+    header.chunkOffset = alignUp(header.slotOffset + uint64_t { sizeof(Entry) } * header.slotCount, TABLE_ALIGNMENT);
+    header.stringsOffset = alignUp(header.chunkOffset + uint64_t { sizeof(Chunk) } * chunkCount, TABLE_ALIGNMENT);
+
+    std::vector<Entry> slots(header.slotCount, Entry {});
+    for (const Entry& entry : entries) {
+        uint32_t slot = static_cast<uint32_t>(entry.pathHash) & (header.slotCount - 1);
+        while (slots[slot].pathLength != 0) {
+            slot = (slot + 1) & (header.slotCount - 1);
+        }
+        slots[slot] = entry;
+    }
+
+    std::vector<Chunk> chunks(chunkCount);
+    uint64_t dataOffset = alignUp(header.stringsOffset + header.stringsSize, CHUNK_ALIGNMENT);
+    for (uint32_t c = 0; c < chunkCount; c++) {
+        chunks[c].offset = dataOffset;
+        chunks[c].size = pending[c].size;
+        chunks[c].storedSize = pending[c].compressed.empty()
+            ? pending[c].size
+            : static_cast<uint32_t>(pending[c].compressed.size());
+        dataOffset = alignUp(dataOffset + chunks[c].storedSize, CHUNK_ALIGNMENT);
+    }
+    header.fileSize = dataOffset;
+
+    // Write next to the destination and rename so a crash never leaves a torn archive behind.
+    std::string tempPath = archivePath + ".tmp";
+    {
+        std::ofstream out { tempPath, std::ios::binary | std::ios::trunc };
+        if (!out) {
+            std::cerr << "failed to create archive " << tempPath << std::endl;
+            return false;
+        }
+
+        const char padding[TABLE_ALIGNMENT] {};
+        auto pad = [&](uint64_t offset) {
+            out.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(out.tellp())));
+        };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        pad(header.slotOffset);
+        out.write(reinterpret_cast<const char*>(slots.data()), sizeof(Entry) * slots.size());
+        pad(header.chunkOffset);
+        out.write(reinterpret_cast<const char*>(chunks.data()), sizeof(Chunk) * chunks.size());
+        pad(header.stringsOffset);
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        for (uint32_t c = 0; c < chunkCount; c++) {
+            pad(chunks[c].offset);
+            const uint8_t* data = pending[c].compressed.empty() ? pending[c].source : pending[c].compressed.data();
+            out.write(reinterpret_cast<const char*>(data), chunks[c].storedSize);
+        }
+        pad(header.fileSize);
+
+        if (!out) {
+            std::cerr << "failed to write archive " << tempPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, archivePath, error);
+    if (error) {
+        std::cerr << "failed to move archive into place: " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool Archive::open(const std::string& archivePath)
+{
+    fileHeader = nullptr;
+    if (!file.open(archivePath) || file.size() < sizeof(Header)) {
+        file.close();
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const Header*>(file.data());
+    bool valid = header->magic == MAGIC
+        && header->version == VERSION
+        && header->fileSize == file.size()
+        && header->slotCount != 0
+        && (header->slotCount & (header->slotCount - 1)) == 0
+        && header->entryCount <= header->slotCount
+        && header->slotOffset % TABLE_ALIGNMENT == 0
+        && header->chunkOffset % TABLE_ALIGNMENT == 0
+        && header->slotOffset >= sizeof(Header)
+        && header->slotOffset + uint64_t { sizeof(Entry) } * header->slotCount <= header->chunkOffset
+        && header->chunkOffset + uint64_t { sizeof(Chunk) } * header->chunkCount <= header->stringsOffset
+        && header->stringsOffset + header->stringsSize <= header->fileSize;
+
+    // Check every table reference once here so lookups and extraction can trust them.
+    if (valid) {
+        const auto* slotTable = reinterpret_cast<const Entry*>(file.data() + header->slotOffset);
+        const auto* chunkTable = reinterpret_cast<const Chunk*>(file.data() + header->chunkOffset);
+        for (uint32_t c = 0; valid && c < header->chunkCount; c++) {
+            const Chunk& chunk = chunkTable[c];
+            valid = chunk.size != 0
+                && chunk.size <= CHUNK_SIZE
+                && chunk.storedSize <= chunk.size
+                && chunk.offset % CHUNK_ALIGNMENT == 0
+                && chunk.offset >= header->stringsOffset + header->stringsSize
+                && chunk.offset + chunk.storedSize <= header->fileSize;
+        }
+        for (uint32_t s = 0; valid && s < header->slotCount; s++) {
+            const Entry& entry = slotTable[s];
+            valid = entry.pathLength == 0
+                || (uint64_t { entry.pathOffset } + entry.pathLength <= header->stringsSize
+                    && entry.chunkCount == chunkCountFor(entry.size)
+                    && uint64_t { entry.firstChunk } + entry.chunkCount <= header->chunkCount
+                    && (entry.chunkCount == 0
+                        || chunkTable[entry.firstChunk + entry.chunkCount - 1].size
+                            == entry.size - uint64_t { entry.chunkCount - 1 } * CHUNK_SIZE));
+        }
+    }
+
+    if (!valid) {
+        file.close();
+        return false;
+    }
+
+    fileHeader = header;
+    return true;
+}
+
+const Archive::Entry* Archive::slots() const
+{
+    return reinterpret_cast<const Entry*>(file.data() + fileHeader->slotOffset);
+}
+
+const Archive::Chunk* Archive::chunks() const
+{
+    return reinterpret_cast<const Chunk*>(file.data() + fileHeader->chunkOffset);
+}
+
+const Archive::Entry* Archive::find(std::string_view path) const
+{
+    if (path.empty()) {
+        return nullptr;
+    }
+
+    uint64_t hash = hashPath(path);
+    uint32_t mask = fileHeader->slotCount - 1;
+    uint32_t slot = static_cast<uint32_t>(hash) & mask;
+    for (uint32_t probe = 0; probe < fileHeader->slotCount; probe++) {
+        const Entry& entry = slots()[slot];
+        if (entry.pathLength == 0) {
+            return nullptr;
+        }
+        if (entry.pathHash == hash && getPath(entry) == path) {
+            return &entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return nullptr;
+}
+
+std::string_view Archive::getPath(const Entry& entry) const
+{
+    const char* strings = reinterpret_cast<const char*>(file.data() + fileHeader->stringsOffset);
+    return { strings + entry.pathOffset, entry.pathLength };
+}
+
+const uint8_t* Archive::view(const Entry& entry) const
+{
+    // Verbatim chunks are full CHUNK_SIZE multiples of CHUNK_ALIGNMENT, so a file stored
+    // without compression is contiguous.
+    const Chunk* first = chunks() + entry.firstChunk;
+    for (uint32_t c = 0; c < entry.chunkCount; c++) {
+        if (first[c].storedSize != first[c].size || first[c].offset != first->offset + uint64_t { c } * CHUNK_SIZE) {
+            return nullptr;
+        }
+    }
+    return entry.chunkCount == 0 ? file.data() : file.data() + first->offset;
+}
+
+bool Archive::extract(const Entry& entry, uint8_t* destination, ThreadPool& threadPool) const
+{
+    const Chunk* first = chunks() + entry.firstChunk;
+    auto extractChunk = [&](uint32_t c) {
+        const Chunk& chunk = first[c];
+        uint8_t* target = destination + uint64_t { c } * CHUNK_SIZE;
+        if (chunk.storedSize == chunk.size) {
+            std::memcpy(target, file.data() + chunk.offset, chunk.size);
+            return true;
+        }
+        return Lz4::decompress(file.data() + chunk.offset, chunk.storedSize, target, chunk.size);
+    };
+
+    if (entry.chunkCount <= 1) {
+        return entry.chunkCount == 0 || extractChunk(0);
+    }
+
+    std::atomic<bool> succeeded { true };
+    threadPool.parallelFor(entry.chunkCount, [&](uint32_t c) {
+        if (!extractChunk(c)) {
+            succeeded = false;
+        }
+    });
+    return succeeded;
+}
+} // namespace fte
@@ -0,0 +1,136 @@
+#include "asset_file_system.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <random>
+
+namespace fte {
+namespace {
+    std::filesystem::path absoluteNormal(const std::string& path)
+    {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        return error ? std::filesystem::path {} : absolute.lexically_normal();
+    }
+
+    // Path of filepath inside root in archive form, or empty when it lies outside.
+    std::string archivePathFor(const std::filesystem::path& filepath, const std::filesystem::path& root)
+    {
+        std::filesystem::path relative = filepath.lexically_relative(root);
+        if (relative.empty() || *relative.begin() == "..") {
+            return {};
+        }
+        return relative.generic_string();
+    }
+}
+
+bool AssetFile::open(const std::string& filepath)
+{
+    return AssetFileSystem::shared().open(filepath, *this);
+}
+
+void AssetFile::close()
+{
+    mappedFile.close();
+    buffer = {};
+    fileData = nullptr;
+    fileSize = 0;
+    opened = false;
+}
+
+AssetFileSystem& AssetFileSystem::shared()
+{
+    static AssetFileSystem fileSystem {};
+    return fileSystem;
+}
+
+bool AssetFileSystem::mount(const std::string& archivePath, const std::string& mountPoint)
+{
+    auto archive = std::make_unique<Archive>();
+    if (!archive->open(archivePath)) {
+        return false;
+    }
+
+    std::cout << "mounted " << archivePath << " (" << archive->header().entryCount << " files) at "
+              << mountPoint << std::endl;
+
+    std::unique_lock<std::shared_mutex> lock { mutex };
+    mounts.push_back({ absoluteNormal(mountPoint), std::move(archive) });
+    return true;
+}
+
+const Archive::Entry* AssetFileSystem::findEntry(const std::string& filepath, const Archive*& archive) const
+{
+    if (mounts.empty()) {
+        return nullptr;
+    }
+
+    std::filesystem::path absolute = absoluteNormal(filepath);
+    for (auto mount = mounts.rbegin(); mount != mounts.rend(); ++mount) {
+        std::string path = archivePathFor(absolute, mount->root);
+        const Archive::Entry* entry = path.empty() ? nullptr : mount->archive->find(path);
+        if (entry != nullptr) {
+            archive = mount->archive.get();
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+bool AssetFileSystem::open(const std::string& filepath, AssetFile& file) const
+{
+    file.close();
+
+    {
+        std::shared_lock<std::shared_mutex> lock { mutex };
+        const Archive* archive = nullptr;
+        if (const Archive::Entry* entry = findEntry(filepath, archive)) {
+            // Mounts are never removed, so views stay valid for the process lifetime.
+            file.fileData = archive->view(*entry);
+            file.fileSize = static_cast<size_t>(entry->size);
+            if (file.fileData == nullptr) {
+                file.buffer.resize(file.fileSize);
+                if (!archive->extract(*entry, file.buffer.data())) {
+                    std::cerr << "corrupt archive entry " << archive->getPath(*entry) << std::endl;
+                    file.close();
+                    return false;
+                }
+                file.fileData = file.buffer.data();
+            }
+            file.opened = true;
+            return true;
+        }
+    }
+
+    if (!file.mappedFile.open(filepath)) {
+        return false;
+    }
+    file.fileData = file.mappedFile.data();
+    file.fileSize = file.mappedFile.size();
+    file.opened = true;
+    return true;
+}
+
+bool AssetFileSystem::exists(const std::string& filepath) const
+{
+    {
+        std::shared_lock<std::shared_mutex> lock { mutex };
+        const Archive* archive = nullptr;
+        if (findEntry(filepath, archive) != nullptr) {
+            return true;
+        }
+    }
+
+    std::error_code error;
+    return std::filesystem::exists(filepath, error);
+}
+
+std::string makeTempPath(const std::string& filepath)
+{
+    // The random tag tells processes apart, the counter the writers within one.
+    static const uint32_t processTag = std::random_device {}();
+    static std::atomic<uint64_t> nextWriter { 0 };
+    return filepath + "." + std::to_string(processTag) + "-" + std::to_string(nextWriter++) + ".tmp";
+}
+} // namespace fte
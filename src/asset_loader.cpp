@@ -0,0 +1,173 @@
+#include "asset_loader.hpp"
+
+#include "texture_cache.hpp"
+#include "upload_manager.hpp"
+
+#include <chrono>
+#include <iostream>
+
+namespace fte {
+namespace {
+    // Unit cube shown in place of meshes that are still loading.
+    Model::Builder createPlaceholderCube()
+    {
+        Model::Builder builder {};
+        const glm::vec3 normals[6] = {
+            { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+            { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+            { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+        };
+
+        for (const glm::vec3& normal : normals) {
+            glm::vec3 u = glm::abs(normal.y) > 0.5f ? glm::vec3 { 1.0f, 0.0f, 0.0f } : glm::vec3 { 0.0f, 1.0f, 0.0f };
+            glm::vec3 v = glm::cross(normal, u);
+
+            uint32_t base = static_cast<uint32_t>(builder.vertices.size());
+            const glm::vec2 corners[4] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+            for (const glm::vec2& corner : corners) {
+                Model::Vertex vertex {};
+                vertex.position = (normal + u * corner.x + v * corner.y) * 0.5f;
+                vertex.color = { 1.0f, 1.0f, 1.0f };
+                vertex.normal = normal;
+                vertex.uv = corner * 0.5f + 0.5f;
+                builder.vertices.push_back(vertex);
+            }
+            for (uint32_t index : { 0u, 1u, 2u, 0u, 2u, 3u }) {
+                builder.indices.push_back(base + index);
+            }
+        }
+        return builder;
+    }
+
+    template <typename T>
+    bool isReady(const std::future<T>& future)
+    {
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+}
+
+AssetLoader::AssetLoader(Device& device, GeometryPool& geometryPool, ThreadPool& threadPool)
+    : treDevice { device }
+    , geometryPool { geometryPool }
+    , threadPool { threadPool }
+{
+    placeholderModel = std::make_shared<Model>(treDevice, geometryPool, createPlaceholderCube());
+
+    Texture::ImageData white {};
+    white.width = 1;
+    white.height = 1;
+    white.pixels = { 255, 255, 255, 255 };
+    placeholderTexture = std::make_shared<Texture>(treDevice, white);
+}
+
+AssetLoader::~AssetLoader()
+{
+    // Workers may still be decoding; let them finish before their results go away.
+    for (auto& load : pendingModels) {
+        if (load.source.valid()) {
+            load.source.wait();
+        }
+    }
+    for (auto& load : pendingTextures) {
+        if (load.source.valid()) {
+            load.source.wait();
+        }
+    }
+}
+
+AssetHandle<Model> AssetLoader::loadModel(const std::string& filepath, Model::VertexFormat format)
+{
+    std::string key = filepath + (format == Model::VertexFormat::Packed ? "#packed" : "");
+    if (auto it = models.find(key); it != models.end()) {
+        return AssetHandle<Model> { it->second };
+    }
+
+    auto state = std::make_shared<AssetHandle<Model>::State>();
+    state->placeholder = placeholderModel;
+    models.emplace(key, state);
+
+    PendingModel load {};
+    load.key = key;
+    load.state = state;
+    load.format = format;
+    load.source = threadPool.submit([filepath]() {
+        Model::Builder builder {};
+        builder.loadFromFile(filepath);
+        return builder;
+    });
+    pendingModels.push_back(std::move(load));
+
+    return AssetHandle<Model> { state };
+}
+
+AssetHandle<Texture> AssetLoader::loadTexture(const std::string& filepath, Texture::Compression compression)
+{
+    if (!treDevice.enabledFeatures.textureCompressionBC) {
+        compression = Texture::Compression::None;
+    }
+
+    std::string key = TextureCache::makeKey(filepath, compression);
+    if (auto it = textures.find(key); it != textures.end()) {
+        return AssetHandle<Texture> { it->second };
+    }
+
+    auto state = std::make_shared<AssetHandle<Texture>::State>();
+    state->placeholder = placeholderTexture;
+    textures.emplace(key, state);
+
+    // Already resident through another path, e.g. Texture::createTextureFromFile.
+    if (auto texture = treDevice.getTextureCache().find(key)) {
+        state->resource = std::move(texture);
+        return AssetHandle<Texture> { state };
+    }
+
+    PendingTexture load {};
+    load.key = key;
+    load.state = state;
+    load.source = threadPool.submit([filepath, compression]() { return Texture::loadImageData(filepath, compression); });
+    pendingTextures.push_back(std::move(load));
+
+    return AssetHandle<Texture> { state };
+}
+
+template <typename T, typename Source, typename Create>
+void AssetLoader::updatePending(std::vector<PendingLoad<T, Source>>& pending,
+    std::unordered_map<std::string, std::shared_ptr<typename AssetHandle<T>::State>>& loaded, Create create)
+{
+    UploadManager& uploads = treDevice.getUploadManager();
+
+    for (size_t i = 0; i < pending.size();) {
+        auto& load = pending[i];
+
+        if (!load.resource && isReady(load.source)) {
+            try {
+                load.resource = create(load.source.get(), load);
+            } catch (const std::exception& e) {
+                // Keep the placeholder and forget the request so it can be retried.
+                std::cerr << "failed to load " << load.key << ": " << e.what() << std::endl;
+                load.state->failed = true;
+                loaded.erase(load.key);
+                pending.erase(pending.begin() + i);
+                continue;
+            }
+        }
+
+        if (load.resource && uploads.isComplete(load.resource->getUploadToken())) {
+            load.state->resource = std::move(load.resource);
+            pending.erase(pending.begin() + i);
+            continue;
+        }
+        i++;
+    }
+}
+
+void AssetLoader::update()
+{
+    updatePending(pendingModels, models, [this](Model::Builder builder, const PendingModel& load) {
+        return std::make_shared<Model>(treDevice, geometryPool, builder, load.format);
+    });
+    updatePending(pendingTextures, textures, [this](Texture::ImageData image, const PendingTexture& load) {
+        return treDevice.getTextureCache().create(load.key, image);
+    });
+}
+} // namespace fte
@@ -0,0 +1,106 @@
+#include "bindless_textures.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace fte {
+BindlessTextures::BindlessTextures(Device& device, std::shared_ptr<Texture> fallback)
+    : treDevice { device }
+    , fallback { std::move(fallback) }
+{
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties {};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(treDevice.getPhysicalDevice(), &properties);
+
+    capacity = std::min({ MAX_TEXTURES,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+    setLayout = DescriptorSetLayout::Builder(treDevice)
+                    .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, capacity,
+                        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+                            | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+                    .build();
+    descriptorPool = DescriptorPool::Builder(treDevice)
+                         .setMaxSets(1)
+                         .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+                         .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity)
+                         .build();
+    if (!descriptorPool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+        throw std::runtime_error("failed to allocate bindless texture descriptor set!");
+    }
+
+    if (getIndex(this->fallback) != 0) {
+        throw std::runtime_error("bindless fallback texture must take slot 0!");
+    }
+}
+
+uint32_t BindlessTextures::getIndex(const std::shared_ptr<Texture>& texture)
+{
+    if (!texture) {
+        return 0;
+    }
+
+    auto it = indices.find(texture.get());
+    if (it != indices.end()) {
+        if (slots[it->second].lock() == texture) {
+            return it->second;
+        }
+        // A new texture at a destroyed one's address; pending frames may still sample the old slot.
+        retireSlot(it->second);
+        indices.erase(it);
+    }
+    uint32_t slot = allocateSlot();
+    indices[texture.get()] = slot;
+    slots[slot] = texture;
+
+    VkDescriptorImageInfo imageInfo {};
+    imageInfo.sampler = texture->getSampler();
+    imageInfo.imageView = texture->getImageView();
+    imageInfo.imageLayout = texture->getImageLayout();
+    DescriptorWriter(*setLayout, *descriptorPool)
+        .writeImage(0, &imageInfo, slot)
+        .overwrite(descriptorSet);
+    return slot;
+}
+
+uint32_t BindlessTextures::allocateSlot()
+{
+    if (slots.size() < capacity) {
+        slots.emplace_back();
+        return static_cast<uint32_t>(slots.size() - 1);
+    }
+
+    for (auto it = indices.begin(); it != indices.end();) {
+        if (slots[it->second].expired()) {
+            retireSlot(it->second);
+            it = indices.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (retiringSlots.empty()) {
+        throw std::runtime_error("bindless texture array is full!");
+    }
+
+    // Oldest first; only waits when every free slot is still in use by a pending frame.
+    RetiringSlot retiring = retiringSlots.front();
+    retiringSlots.pop_front();
+    treDevice.getGraphicsTimeline().wait(retiring.retireValue);
+    return retiring.slot;
+}
+
+void BindlessTextures::retireSlot(uint32_t slot)
+{
+    // A slot is only free once the submissions made before its texture was destroyed have
+    // completed: until then frames may sample it, and UPDATE_UNUSED_WHILE_PENDING forbids
+    // rewriting it. Every such submission precedes this call, so its last value covers them.
+    slots[slot].reset();
+    retiringSlots.push_back({ slot, treDevice.getGraphicsTimeline().getLastSubmittedValue() });
+}
+} // namespace fte
@@ -0,0 +1,542 @@
+#include "block_compressor.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FTE_BLOCK_COMPRESSOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace fte {
+namespace {
+    constexpr uint32_t BLOCK_TEXELS = 16;
+
+    // One 4x4 block as four channel rows, so the palette search can load four texels of a
+    // channel at once.
+    struct BlockTexels {
+        alignas(16) float channels[4][BLOCK_TEXELS];
+    };
+
+    struct Endpoints {
+        float colors[2][4];
+    };
+
+    BlockTexels loadBlock(const uint8_t* rgba)
+    {
+        BlockTexels texels;
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                texels.channels[c][i] = rgba[i * 4 + c];
+            }
+        }
+        return texels;
+    }
+
+    // Picks the nearest palette entry for every texel and returns the summed weighted
+    // squared error.
+    float selectIndices(const BlockTexels& texels, const float (*palette)[4], uint32_t paletteSize,
+        const float weights[4], uint8_t indices[BLOCK_TEXELS])
+    {
+#ifdef FTE_BLOCK_COMPRESSOR_SSE2
+        __m128 totalError = _mm_setzero_ps();
+        for (uint32_t group = 0; group < BLOCK_TEXELS; group += 4) {
+            __m128 channels[4];
+            for (uint32_t c = 0; c < 4; c++) {
+                channels[c] = _mm_load_ps(&texels.channels[c][group]);
+            }
+
+            __m128 bestError = _mm_set1_ps(std::numeric_limits<float>::max());
+            __m128 bestIndex = _mm_setzero_ps();
+            for (uint32_t p = 0; p < paletteSize; p++) {
+                __m128 error = _mm_setzero_ps();
+                for (uint32_t c = 0; c < 4; c++) {
+                    __m128 delta = _mm_sub_ps(channels[c], _mm_set1_ps(palette[p][c]));
+                    error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(delta, delta), _mm_set1_ps(weights[c])));
+                }
+                __m128 better = _mm_cmplt_ps(error, bestError);
+                bestError = _mm_min_ps(error, bestError);
+                bestIndex = _mm_or_ps(_mm_and_ps(better, _mm_set1_ps(static_cast<float>(p))),
+                    _mm_andnot_ps(better, bestIndex));
+            }
+            totalError = _mm_add_ps(totalError, bestError);
+
+            alignas(16) int32_t groupIndices[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(groupIndices), _mm_cvttps_epi32(bestIndex));
+            for (uint32_t i = 0; i < 4; i++) {
+                indices[group + i] = static_cast<uint8_t>(groupIndices[i]);
+            }
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, totalError);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+        float totalError = 0.0f;
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            float bestError = std::numeric_limits<float>::max();
+            for (uint32_t p = 0; p < paletteSize; p++) {
+                float error = 0.0f;
+                for (uint32_t c = 0; c < 4; c++) {
+                    float delta = texels.channels[c][i] - palette[p][c];
+                    error += delta * delta * weights[c];
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    indices[i] = static_cast<uint8_t>(p);
+                }
+            }
+            totalError += bestError;
+        }
+        return totalError;
+#endif
+    }
+
+    // Endpoints along the principal axis of the block's colors, spanning every texel.
+    Endpoints fitPrincipalAxis(const BlockTexels& texels, uint32_t channelCount)
+    {
+        float mean[4] {};
+        float minimum[4];
+        float maximum[4];
+        for (uint32_t c = 0; c < channelCount; c++) {
+            minimum[c] = maximum[c] = texels.channels[c][0];
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                mean[c] += texels.channels[c][i];
+                minimum[c] = std::min(minimum[c], texels.channels[c][i]);
+                maximum[c] = std::max(maximum[c], texels.channels[c][i]);
+            }
+            mean[c] /= BLOCK_TEXELS;
+        }
+
+        float covariance[4][4] {};
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            for (uint32_t a = 0; a < channelCount; a++) {
+                for (uint32_t b = a; b < channelCount; b++) {
+                    covariance[a][b] += (texels.channels[a][i] - mean[a]) * (texels.channels[b][i] - mean[b]);
+                }
+            }
+        }
+        for (uint32_t a = 0; a < channelCount; a++) {
+            for (uint32_t b = 0; b < a; b++) {
+                covariance[a][b] = covariance[b][a];
+            }
+        }
+
+        // Power iteration from the bounding box diagonal converges in a handful of steps.
+        float axis[4] {};
+        for (uint32_t c = 0; c < channelCount; c++) {
+            axis[c] = maximum[c] - minimum[c];
+        }
+        for (int iteration = 0; iteration < 8; iteration++) {
+            float next[4] {};
+            float length = 0.0f;
+            for (uint32_t a = 0; a < channelCount; a++) {
+                for (uint32_t b = 0; b < channelCount; b++) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length = std::max(length, std::abs(next[a]));
+            }
+            if (length < 1e-6f) {
+                break;
+            }
+            for (uint32_t c = 0; c < channelCount; c++) {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float lengthSquared = 0.0f;
+        for (uint32_t c = 0; c < channelCount; c++) {
+            lengthSquared += axis[c] * axis[c];
+        }
+
+        Endpoints endpoints {};
+        if (lengthSquared < 1e-12f) {
+            for (uint32_t c = 0; c < channelCount; c++) {
+                endpoints.colors[0][c] = endpoints.colors[1][c] = mean[c];
+            }
+            return endpoints;
+        }
+
+        float lowest = std::numeric_limits<float>::max();
+        float highest = -std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < channelCount; c++) {
+                t += (texels.channels[c][i] - mean[c]) * axis[c];
+            }
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+        }
+        for (uint32_t c = 0; c < channelCount; c++) {
+            endpoints.colors[0][c] = std::clamp(mean[c] + axis[c] * lowest / lengthSquared, 0.0f, 255.0f);
+            endpoints.colors[1][c] = std::clamp(mean[c] + axis[c] * highest / lengthSquared, 0.0f, 255.0f);
+        }
+        return endpoints;
+    }
+
+    // Least squares endpoints for fixed indices; fractions[i] is how far palette entry i
+    // lies from endpoint 0 towards endpoint 1. Returns false if the system is singular.
+    bool refineEndpoints(const BlockTexels& texels, const uint8_t indices[BLOCK_TEXELS], const float* fractions,
+        uint32_t channelCount, Endpoints& endpoints)
+    {
+        float aa = 0.0f;
+        float ab = 0.0f;
+        float bb = 0.0f;
+        float ax[4] {};
+        float bx[4] {};
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            float b = fractions[indices[i]];
+            float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = 0; c < channelCount; c++) {
+                ax[c] += a * texels.channels[c][i];
+                bx[c] += b * texels.channels[c][i];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) {
+            return false;
+        }
+        for (uint32_t c = 0; c < channelCount; c++) {
+            endpoints.colors[0][c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+            endpoints.colors[1][c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    // Appends bits least significant first, the order BC7 blocks are laid out in.
+    class BitWriter {
+    public:
+        explicit BitWriter(uint8_t* data)
+            : data { data }
+        {
+        }
+
+        void write(uint32_t value, uint32_t bitCount)
+        {
+            for (uint32_t i = 0; i < bitCount; i++, position++) {
+                data[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (position & 7));
+            }
+        }
+
+    private:
+        uint8_t* data;
+        uint32_t position = 0;
+    };
+
+    // BC1 -----------------------------------------------------------------------------
+
+    constexpr float BC1_WEIGHTS[4] = { 0.299f, 0.587f, 0.114f, 0.0f };
+    constexpr float BC1_FRACTIONS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    struct Bc1Candidate {
+        uint16_t packed[2];
+        uint8_t indices[BLOCK_TEXELS];
+        float error;
+    };
+
+    uint16_t packRgb565(const float color[4])
+    {
+        auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+        auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+        auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRgb565(uint16_t packed, float color[4])
+    {
+        uint32_t r = (packed >> 11) & 31;
+        uint32_t g = (packed >> 5) & 63;
+        uint32_t b = packed & 31;
+        color[0] = static_cast<float>((r << 3) | (r >> 2));
+        color[1] = static_cast<float>((g << 2) | (g >> 4));
+        color[2] = static_cast<float>((b << 3) | (b >> 2));
+        color[3] = 255.0f;
+    }
+
+    Bc1Candidate evaluateBc1(const BlockTexels& texels, const Endpoints& endpoints)
+    {
+        Bc1Candidate candidate {};
+        candidate.packed[0] = packRgb565(endpoints.colors[0]);
+        candidate.packed[1] = packRgb565(endpoints.colors[1]);
+
+        float palette[4][4];
+        unpackRgb565(candidate.packed[0], palette[0]);
+        unpackRgb565(candidate.packed[1], palette[1]);
+        for (uint32_t c = 0; c < 4; c++) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        candidate.error = selectIndices(texels, palette, 4, BC1_WEIGHTS, candidate.indices);
+        return candidate;
+    }
+
+    // BC7 mode 6 ----------------------------------------------------------------------
+
+    constexpr float BC7_WEIGHTS[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    constexpr uint32_t BC7_INDEX_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bc7Candidate {
+        uint8_t endpoints[2][4]; // 7-bit values, before the p-bit
+        uint8_t pBits[2];
+        uint8_t indices[BLOCK_TEXELS];
+        float error;
+    };
+
+    Bc7Candidate evaluateBc7(const BlockTexels& texels, const Endpoints& endpoints)
+    {
+        Bc7Candidate best {};
+        best.error = std::numeric_limits<float>::max();
+
+        // Each endpoint shares one p-bit as the low bit of all four channels; try all four
+        // combinations.
+        for (uint8_t pBits = 0; pBits < 4; pBits++) {
+            Bc7Candidate candidate {};
+            float expanded[2][4];
+            for (uint32_t e = 0; e < 2; e++) {
+                candidate.pBits[e] = (pBits >> e) & 1;
+                for (uint32_t c = 0; c < 4; c++) {
+                    long quantized = std::lround((endpoints.colors[e][c] - candidate.pBits[e]) * 0.5f);
+                    candidate.endpoints[e][c] = static_cast<uint8_t>(std::clamp(quantized, 0l, 127l));
+                    expanded[e][c] = static_cast<float>((candidate.endpoints[e][c] << 1) | candidate.pBits[e]);
+                }
+            }
+
+            float palette[16][4];
+            for (uint32_t p = 0; p < 16; p++) {
+                for (uint32_t c = 0; c < 4; c++) {
+                    uint32_t e0 = static_cast<uint32_t>(expanded[0][c]);
+                    uint32_t e1 = static_cast<uint32_t>(expanded[1][c]);
+                    palette[p][c] = static_cast<float>(((64 - BC7_INDEX_WEIGHTS[p]) * e0 + BC7_INDEX_WEIGHTS[p] * e1 + 32) >> 6);
+                }
+            }
+
+            candidate.error = selectIndices(texels, palette, 16, BC7_WEIGHTS, candidate.indices);
+            if (candidate.error < best.error) {
+                best = candidate;
+            }
+        }
+        return best;
+    }
+
+    // Mip chain -----------------------------------------------------------------------
+
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> rgba;
+    };
+
+    float srgbToLinear(uint8_t value)
+    {
+        static const auto table = []() {
+            std::array<float, 256> values {};
+            for (uint32_t i = 0; i < 256; i++) {
+                float s = i / 255.0f;
+                values[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+            }
+            return values;
+        }();
+        return table[value];
+    }
+
+    uint8_t linearToSrgb(float value)
+    {
+        float s = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::clamp(std::lround(s * 255.0f), 0l, 255l));
+    }
+
+    Level downsample(const Level& source, ThreadPool& threadPool)
+    {
+        Level level {};
+        level.width = std::max(source.width / 2, 1u);
+        level.height = std::max(source.height / 2, 1u);
+        level.rgba.resize(size_t { level.width } * level.height * 4);
+
+        threadPool.parallelFor(level.height, [&](uint32_t y) {
+            uint32_t y0 = std::min(y * 2, source.height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+            for (uint32_t x = 0; x < level.width; x++) {
+                uint32_t x0 = std::min(x * 2, source.width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                const uint8_t* texels[4] = {
+                    &source.rgba[(size_t { y0 } * source.width + x0) * 4],
+                    &source.rgba[(size_t { y0 } * source.width + x1) * 4],
+                    &source.rgba[(size_t { y1 } * source.width + x0) * 4],
+                    &source.rgba[(size_t { y1 } * source.width + x1) * 4],
+                };
+
+                uint8_t* out = &level.rgba[(size_t { y } * level.width + x) * 4];
+                for (uint32_t c = 0; c < 3; c++) {
+                    float sum = 0.0f;
+                    for (const uint8_t* texel : texels) {
+                        sum += srgbToLinear(texel[c]);
+                    }
+                    out[c] = linearToSrgb(sum * 0.25f);
+                }
+                out[3] = static_cast<uint8_t>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+            }
+        });
+        return level;
+    }
+}
+
+void BlockCompressor::encodeBC1Block(const uint8_t* rgba, uint8_t* block)
+{
+    BlockTexels texels = loadBlock(rgba);
+
+    Endpoints endpoints = fitPrincipalAxis(texels, 3);
+    Bc1Candidate best = evaluateBc1(texels, endpoints);
+    for (int iteration = 0; iteration < 2 && best.error > 0.0f; iteration++) {
+        if (!refineEndpoints(texels, best.indices, BC1_FRACTIONS, 3, endpoints)) {
+            break;
+        }
+        Bc1Candidate refined = evaluateBc1(texels, endpoints);
+        if (refined.error >= best.error) {
+            break;
+        }
+        best = refined;
+    }
+
+    // color0 > color1 selects the four-color mode; equal endpoints need every index on 0.
+    uint32_t indexBits = 0;
+    if (best.packed[0] == best.packed[1]) {
+        std::memset(best.indices, 0, sizeof(best.indices));
+    } else if (best.packed[0] < best.packed[1]) {
+        std::swap(best.packed[0], best.packed[1]);
+        for (uint8_t& index : best.indices) {
+            index ^= 1;
+        }
+    }
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        indexBits |= uint32_t { best.indices[i] } << (i * 2);
+    }
+
+    std::memcpy(block, &best.packed[0], 2);
+    std::memcpy(block + 2, &best.packed[1], 2);
+    std::memcpy(block + 4, &indexBits, 4);
+}
+
+void BlockCompressor::encodeBC7Block(const uint8_t* rgba, uint8_t* block)
+{
+    BlockTexels texels = loadBlock(rgba);
+
+    float fractions[16];
+    for (uint32_t i = 0; i < 16; i++) {
+        fractions[i] = BC7_INDEX_WEIGHTS[i] / 64.0f;
+    }
+
+    Endpoints endpoints = fitPrincipalAxis(texels, 4);
+    Bc7Candidate best = evaluateBc7(texels, endpoints);
+    for (int iteration = 0; iteration < 2 && best.error > 0.0f; iteration++) {
+        if (!refineEndpoints(texels, best.indices, fractions, 4, endpoints)) {
+            break;
+        }
+        Bc7Candidate refined = evaluateBc7(texels, endpoints);
+        if (refined.error >= best.error) {
+            break;
+        }
+        best = refined;
+    }
+
+    // The first texel's index is stored with an implicit zero top bit.
+    if (best.indices[0] >= 8) {
+        std::swap(best.endpoints[0], best.endpoints[1]);
+        std::swap(best.pBits[0], best.pBits[1]);
+        for (uint8_t& index : best.indices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    std::memset(block, 0, 16);
+    BitWriter writer { block };
+    writer.write(1u << 6, 7);
+    for (uint32_t c = 0; c < 4; c++) {
+        writer.write(best.endpoints[0][c], 7);
+        writer.write(best.endpoints[1][c], 7);
+    }
+    writer.write(best.pBits[0], 1);
+    writer.write(best.pBits[1], 1);
+    writer.write(best.indices[0], 3);
+    for (uint32_t i = 1; i < BLOCK_TEXELS; i++) {
+        writer.write(best.indices[i], 4);
+    }
+}
+
+Texture::ImageData BlockCompressor::compress(const Texture::ImageData& image, Format format, ThreadPool& threadPool)
+{
+    if (!image.levels.empty() || image.format != VK_FORMAT_R8G8B8A8_SRGB || image.width <= 0 || image.height <= 0) {
+        throw std::runtime_error("block compression needs a single RGBA8 sRGB level!");
+    }
+
+    std::vector<Level> levels;
+    levels.push_back({ static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), image.pixels });
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        levels.push_back(downsample(levels.back(), threadPool));
+    }
+
+    const uint32_t blockSize = format == Format::BC1 ? 8 : 16;
+
+    Texture::ImageData compressed {};
+    compressed.width = image.width;
+    compressed.height = image.height;
+    compressed.format = format == Format::BC1 ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+    compressed.levels.resize(levels.size());
+
+    // Same 16-byte level alignment as Ktx2::read, so both paths upload identically.
+    struct BlockRow {
+        uint32_t level;
+        uint32_t y;
+    };
+    std::vector<BlockRow> rows;
+    VkDeviceSize totalSize = 0;
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        uint32_t blocksX = (levels[level].width + 3) / 4;
+        uint32_t blocksY = (levels[level].height + 3) / 4;
+
+        auto& mip = compressed.levels[level];
+        mip.offset = totalSize;
+        mip.size = VkDeviceSize { blocksX } * blocksY * blockSize;
+        mip.width = levels[level].width;
+        mip.height = levels[level].height;
+        totalSize += (mip.size + 15) & ~VkDeviceSize { 15 };
+
+        for (uint32_t y = 0; y < blocksY; y++) {
+            rows.push_back({ level, y });
+        }
+    }
+    compressed.pixels.resize(totalSize);
+
+    threadPool.parallelFor(static_cast<uint32_t>(rows.size()), [&](uint32_t rowIndex) {
+        const BlockRow& row = rows[rowIndex];
+        const Level& level = levels[row.level];
+        uint8_t* out = compressed.pixels.data() + compressed.levels[row.level].offset
+            + VkDeviceSize { row.y } * ((level.width + 3) / 4) * blockSize;
+
+        // Edge blocks repeat the last row and column of texels.
+        uint8_t rgba[BLOCK_TEXELS * 4];
+        for (uint32_t blockX = 0; blockX < (level.width + 3) / 4; blockX++) {
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                uint32_t x = std::min(blockX * 4 + i % 4, level.width - 1);
+                uint32_t y = std::min(row.y * 4 + i / 4, level.height - 1);
+                std::memcpy(&rgba[i * 4], &level.rgba[(size_t { y } * level.width + x) * 4], 4);
+            }
+
+            if (format == Format::BC1) {
+                encodeBC1Block(rgba, out + blockX * blockSize);
+            } else {
+                encodeBC7Block(rgba, out + blockX * blockSize);
+            }
+        }
+    });
+    return compressed;
+}
+} // namespace fte
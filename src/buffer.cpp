@@ -27,61 +27,61 @@ Buffer::Buffer(
 {
     alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
     bufferSize = alignmentSize * instanceCount;
-    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
 }
 
 Buffer::~Buffer()
 {
     unmap();
     vkDestroyBuffer(treDevice.getLogicalDevice(), buffer, nullptr);
-    vkFreeMemory(treDevice.getLogicalDevice(), memory, nullptr);
+    treDevice.getMemoryAllocator().free(allocation);
 }
 
+// Host-visible memory is mapped once by the allocator (its blocks are shared, and a
+// VkDeviceMemory can only be mapped once), so map and unmap only hand out that pointer.
 VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset)
 {
-    assert(buffer && memory && "Called map on buffer before create");
-    return vkMapMemory(treDevice.getLogicalDevice(), memory, offset, size, 0, &mapped);
+    assert(buffer && allocation.isValid() && "Called map on buffer before create");
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? bufferSize : offset + size;
+    if (allocation.mapped == nullptr || offset > end || end > bufferSize) {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    mapped = static_cast<char*>(allocation.mapped) + offset;
+    mappedOffset = offset;
+    return VK_SUCCESS;
 }
 
 void Buffer::unmap()
 {
-    if (mapped) {
-        vkUnmapMemory(treDevice.getLogicalDevice(), memory);
-        mapped = nullptr;
-    }
+    mapped = nullptr;
 }
 
-void Buffer::writeToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset)
+void Buffer::writeToBuffer(const void* data, VkDeviceSize size, VkDeviceSize offset)
 {
     assert(mapped && "Cannot copy to unmapped buffer");
 
     if (size == VK_WHOLE_SIZE) {
-        memcpy(mapped, data, bufferSize);
-    } else {
-        char* memOffset = (char*)mapped;
-        memOffset += offset;
-        memcpy(memOffset, data, size);
+        size = bufferSize - mappedOffset - offset;
     }
+    memcpy(static_cast<char*>(mapped) + offset, data, size);
+    markDirty(size, mappedOffset + offset);
+}
+
+void Buffer::markDirty(VkDeviceSize size, VkDeviceSize offset)
+{
+    treDevice.getMemoryAllocator().markDirty(allocation, offset, size == VK_WHOLE_SIZE ? bufferSize - offset : size);
 }
 
+// The allocator widens the range to whole atoms; the buffer's memory may be shared.
 VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset)
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkFlushMappedMemoryRanges(treDevice.getLogicalDevice(), 1, &mappedRange);
+    return treDevice.getMemoryAllocator().flush(allocation, offset, size == VK_WHOLE_SIZE ? bufferSize - offset : size);
 }
 
 VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset)
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkInvalidateMappedMemoryRanges(treDevice.getLogicalDevice(), 1, &mappedRange);
+    return treDevice.getMemoryAllocator().invalidate(
+        allocation, offset, size == VK_WHOLE_SIZE ? bufferSize - offset : size);
 }
 
 VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize size, VkDeviceSize offset)
@@ -93,7 +93,7 @@ VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize size, VkDeviceSize of
     };
 }
 
-void Buffer::writeToIndex(void* data, int index)
+void Buffer::writeToIndex(const void* data, int index)
 {
     writeToBuffer(data, instanceSize, index * alignmentSize);
 }
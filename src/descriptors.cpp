@@ -9,7 +9,8 @@ namespace fte {
 		uint32_t binding,
 		VkDescriptorType descriptorType,
 		VkShaderStageFlags stageFlags,
-		uint32_t count) {
+		uint32_t count,
+		VkDescriptorBindingFlags flags) {
 		assert(bindings.count(binding) == 0 && "Binding already in use");
 		VkDescriptorSetLayoutBinding layoutBinding{};
 		layoutBinding.binding = binding;
@@ -17,25 +18,45 @@ namespace fte {
 		layoutBinding.descriptorCount = count;
 		layoutBinding.stageFlags = stageFlags;
 		bindings[binding] = layoutBinding;
+		if (flags != 0) {
+			bindingFlags[binding] = flags;
+		}
 		return *this;
 	}
 
 	std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const {
-		return std::make_unique<DescriptorSetLayout>(treDevice, bindings);
+		return std::make_unique<DescriptorSetLayout>(treDevice, bindings, bindingFlags);
 	}
 
 	// *************** Descriptor Set Layout *********************
 
 	DescriptorSetLayout::DescriptorSetLayout(
-		Device& treDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+		Device& treDevice,
+		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+		std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags)
 		: treDevice{ treDevice }, bindings{ bindings } {
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+		std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+		VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
 		for (auto kv : bindings) {
 			setLayoutBindings.push_back(kv.second);
+
+			auto flags = bindingFlags.find(kv.first);
+			setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+			if (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) {
+				layoutFlags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+			}
 		}
 
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
 		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
 		descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descriptorSetLayoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+		descriptorSetLayoutInfo.flags = layoutFlags;
 		descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
 		descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
@@ -155,19 +176,20 @@ namespace fte {
 	}
 
 	DescriptorWriter& DescriptorWriter::writeImage(
-		uint32_t binding, VkDescriptorImageInfo* imageInfo) {
+		uint32_t binding, VkDescriptorImageInfo* imageInfo, uint32_t arrayElement) {
 		assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
 
 		auto& bindingDescription = setLayout.bindings[binding];
 
 		assert(
-			bindingDescription.descriptorCount == 1 &&
-			"Binding single descriptor info, but binding expects multiple");
+			arrayElement < bindingDescription.descriptorCount &&
+			"Array element is outside the binding");
 
 		VkWriteDescriptorSet write{};
 		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		write.descriptorType = bindingDescription.descriptorType;
 		write.dstBinding = binding;
+		write.dstArrayElement = arrayElement;
 		write.pImageInfo = imageInfo;
 		write.descriptorCount = 1;
 
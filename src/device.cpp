@@ -1,5 +1,9 @@
 #include "device.hpp"
 
+#include "sampler_cache.hpp"
+#include "texture_cache.hpp"
+#include "upload_manager.hpp"
+
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -46,6 +50,36 @@ namespace fte
         }
     }
 
+    static MemoryAllocator::Category categorizeBuffer(VkBufferUsageFlags usage)
+    {
+        if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+        {
+            return MemoryAllocator::Category::Mesh;
+        }
+        if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+        {
+            return MemoryAllocator::Category::Uniform;
+        }
+        if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+        {
+            return MemoryAllocator::Category::Staging;
+        }
+        return MemoryAllocator::Category::Other;
+    }
+
+    static MemoryAllocator::Category categorizeImage(VkImageUsageFlags usage)
+    {
+        if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+        {
+            return MemoryAllocator::Category::Attachment;
+        }
+        if (usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+        {
+            return MemoryAllocator::Category::Texture;
+        }
+        return MemoryAllocator::Category::Other;
+    }
+
     Device::Device(Window &window) : window{window}
     {
         createInstance();
@@ -54,10 +88,32 @@ namespace fte
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        memoryAllocator = std::make_unique<MemoryAllocator>(physicalDevice, logicalDevice);
+        graphicsTimeline = std::make_unique<Timeline>(logicalDevice);
+        QueueFamilies indices = findQueueFamilies();
+        if (indices.hasDedicatedTransferFamily())
+        {
+            transferTimeline = std::make_unique<Timeline>(logicalDevice);
+        }
+        if (indices.hasDedicatedComputeFamily())
+        {
+            computeTimeline = std::make_unique<Timeline>(logicalDevice);
+        }
+        uploadManager = std::make_unique<UploadManager>(*this);
+        samplerCache = std::make_unique<SamplerCache>(*this);
+        textureCache = std::make_unique<TextureCache>(*this);
     }
 
     Device::~Device()
     {
+        textureCache.reset();
+        samplerCache.reset();
+        uploadManager.reset();
+        flushDeferredDestroys();
+        computeTimeline.reset();
+        transferTimeline.reset();
+        graphicsTimeline.reset();
+        memoryAllocator.reset();
         vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
         vkDestroyDevice(logicalDevice, nullptr);
 
@@ -234,7 +290,8 @@ namespace fte
         QueueFamilies indices = findQueueFamilies(physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+        std::set<uint32_t> uniqueQueueFamilies = {
+            indices.graphicsFamily, indices.presentFamily, indices.transferFamily, indices.computeFamily};
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -247,18 +304,47 @@ namespace fte
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // Optional; meshlet draws fall back to one indirect call per range without it.
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        // Optional; BC-compressed KTX2 textures are rejected by findSupportedFormat without it.
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        enabledFeatures = deviceFeatures;
+
+        // Descriptor indexing for the bindless texture array; isPhysicalDeviceSuitable
+        // guarantees support.
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        vulkan12Features.timelineSemaphore = VK_TRUE;
+        enabledVulkan12Features = vulkan12Features;
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &vulkan12Features;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+        // Optional; getMemoryBudget estimates without it.
+        std::vector<const char *> enabledExtensions = deviceExtensions;
+        memoryBudgetSupported = isDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memoryBudgetSupported)
+        {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -279,6 +365,8 @@ namespace fte
 
         vkGetDeviceQueue(logicalDevice, indices.graphicsFamily, 0, &graphicsQueue);
         vkGetDeviceQueue(logicalDevice, indices.presentFamily, 0, &presentQueue);
+        vkGetDeviceQueue(logicalDevice, indices.transferFamily, 0, &transferQueue);
+        vkGetDeviceQueue(logicalDevice, indices.computeFamily, 0, &computeQueue);
     }
 
     void Device::createCommandPool()
@@ -288,7 +376,9 @@ namespace fte
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        // Only for beginSingleTimeCommands, whose buffers are freed after one use; per-frame
+        // recording uses the renderer's FrameContexts.
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
         if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
         {
@@ -320,7 +410,30 @@ namespace fte
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-        return indices.isValid() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+        return indices.isValid() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy &&
+               supportsBindlessTextures(device);
+    }
+
+    bool Device::supportsBindlessTextures(VkPhysicalDevice device)
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+        if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+        {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return vulkan12Features.descriptorIndexing && vulkan12Features.runtimeDescriptorArray &&
+               vulkan12Features.descriptorBindingPartiallyBound &&
+               vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+               vulkan12Features.descriptorBindingUpdateUnusedWhilePending && vulkan12Features.timelineSemaphore;
     }
 
     void Device::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo)
@@ -431,6 +544,24 @@ namespace fte
         return requiredExtensions.empty();
     }
 
+    bool Device::isDeviceExtensionSupported(const char *name) const
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto &extension : availableExtensions)
+        {
+            if (std::strcmp(extension.extensionName, name) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     QueueFamilies Device::findQueueFamilies(VkPhysicalDevice device) const
     {
         QueueFamilies indices;
@@ -464,6 +595,32 @@ namespace fte
             i++;
         }
 
+        if (!indices.isValid())
+        {
+            return indices;
+        }
+
+        // Fall back to the graphics queue on single-queue implementations such as lavapipe.
+        indices.transferFamily = indices.graphicsFamily;
+        indices.computeFamily = indices.graphicsFamily;
+        for (uint32_t family = 0; family < queueFamilyCount; family++)
+        {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (queueFamilies[family].queueCount == 0 || (flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                continue;
+            }
+            if ((flags & VK_QUEUE_COMPUTE_BIT) && !indices.hasDedicatedComputeFamily())
+            {
+                indices.computeFamily = family;
+            }
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT) &&
+                !indices.hasDedicatedTransferFamily())
+            {
+                indices.transferFamily = family;
+            }
+        }
+
         return indices;
     }
 
@@ -532,7 +689,7 @@ namespace fte
                               VkBufferUsageFlags usage,
                               VkMemoryPropertyFlags properties,
                               VkBuffer &buffer,
-                              VkDeviceMemory &bufferMemory)
+                              MemoryAllocator::Allocation &bufferAllocation)
     {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -545,20 +702,13 @@ namespace fte
             throw std::runtime_error("failed to create vertex buffer!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(logicalDevice, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        bufferAllocation = memoryAllocator->allocateForBuffer(
+            buffer, properties, MemoryAllocator::Pool::General, categorizeBuffer(usage));
 
-        if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+        if (vkBindBufferMemory(logicalDevice, buffer, bufferAllocation.memory, bufferAllocation.offset) != VK_SUCCESS)
         {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+            throw std::runtime_error("failed to bind buffer memory!");
         }
-
-        vkBindBufferMemory(logicalDevice, buffer, bufferMemory, 0);
     }
 
     VkCommandBuffer Device::beginSingleTimeCommands()
@@ -589,19 +739,23 @@ namespace fte
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
+        // Waits for this submission only, not for frames still in flight on the queue.
+        graphicsTimeline->wait(graphicsTimeline->submit(graphicsQueue, submitInfo));
 
         vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
     }
 
-    void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+    void Device::copyBuffer(VkBuffer srcBuffer,
+                            VkBuffer dstBuffer,
+                            VkDeviceSize size,
+                            VkDeviceSize srcOffset,
+                            VkDeviceSize dstOffset)
     {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
         VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0; // Optional
-        copyRegion.dstOffset = 0; // Optional
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -638,8 +792,9 @@ namespace fte
                              VkImageUsageFlags usage,
                              VkMemoryPropertyFlags properties,
                              VkImage &image,
-                             VkDeviceMemory &imageMemory,
-                             const VkImageCreateInfo *customImageInfo)
+                             MemoryAllocator::Allocation &imageAllocation,
+                             const VkImageCreateInfo *customImageInfo,
+                             MemoryAllocator::Pool pool)
     {
         VkImageCreateInfo imageInfo{};
         if (customImageInfo)
@@ -668,20 +823,9 @@ namespace fte
             throw std::runtime_error("failed to create image!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(logicalDevice, image, &memRequirements);
+        imageAllocation = memoryAllocator->allocateForImage(image, properties, pool, categorizeImage(imageInfo.usage));
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        if (vkBindImageMemory(logicalDevice, image, imageMemory, 0) != VK_SUCCESS)
+        if (vkBindImageMemory(logicalDevice, image, imageAllocation.memory, imageAllocation.offset) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to bind image memory!");
         }
@@ -720,4 +864,91 @@ namespace fte
 
         return VK_SAMPLE_COUNT_1_BIT;
     }
-} // namespace tre
\ No newline at end of file
+
+    MemoryBudget Device::getMemoryBudget() const
+    {
+        MemoryBudget budget{};
+        budget.statistics = memoryAllocator->getStatistics();
+        budget.fromDriver = memoryBudgetSupported;
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties.pNext = memoryBudgetSupported ? &budgetProperties : nullptr;
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties);
+
+        const auto &heaps = memoryProperties.memoryProperties.memoryHeaps;
+        for (uint32_t i = 0; i < memoryProperties.memoryProperties.memoryHeapCount; i++)
+        {
+            MemoryHeapBudget heap{};
+            heap.size = heaps[i].size;
+            heap.reserved = budget.statistics.heapReservedBytes[i];
+            heap.used = budget.statistics.heapUsedBytes[i];
+            heap.deviceLocal = (heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+            if (memoryBudgetSupported)
+            {
+                heap.budget = budgetProperties.heapBudget[i];
+                heap.usage = budgetProperties.heapUsage[i];
+            }
+            else
+            {
+                heap.budget = heaps[i].size / 10 * 8;
+                heap.usage = heap.reserved;
+            }
+            budget.heaps.push_back(heap);
+        }
+        return budget;
+    }
+
+    void Device::logMemoryBudget() const
+    {
+        constexpr double MiB = 1024.0 * 1024.0;
+        MemoryBudget budget = getMemoryBudget();
+
+        std::cout << std::fixed << std::setprecision(1) << "Memory" << (budget.fromDriver ? "" : " (estimated)") << ":";
+        for (size_t i = 0; i < budget.heaps.size(); i++)
+        {
+            const auto &heap = budget.heaps[i];
+            if (heap.usage == 0 && heap.reserved == 0)
+            {
+                continue;
+            }
+            std::cout << " heap " << i << (heap.deviceLocal ? " (device)" : " (host)") << " " << heap.usage / MiB
+                      << "/" << heap.budget / MiB << " MiB, engine " << heap.used / MiB << "/" << heap.reserved / MiB
+                      << " MiB;";
+        }
+        for (uint32_t i = 0; i < MemoryAllocator::CATEGORY_COUNT; i++)
+        {
+            std::cout << (i == 0 ? " " : ", ")
+                      << MemoryAllocator::getCategoryName(static_cast<MemoryAllocator::Category>(i)) << " "
+                      << budget.statistics.categoryBytes[i] / MiB << " MiB";
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    void Device::deferDestroy(std::function<void()> destroy)
+    {
+        deferredDestroys.push_back({graphicsTimeline->getLastSubmittedValue(), std::move(destroy)});
+    }
+
+    void Device::retireDeferredDestroys()
+    {
+        while (!deferredDestroys.empty() && graphicsTimeline->isComplete(deferredDestroys.front().retireValue))
+        {
+            // Popped first, since destroy may defer more work.
+            std::function<void()> destroy = std::move(deferredDestroys.front().destroy);
+            deferredDestroys.pop_front();
+            destroy();
+        }
+    }
+
+    void Device::flushDeferredDestroys()
+    {
+        while (!deferredDestroys.empty())
+        {
+            graphicsTimeline->wait(deferredDestroys.front().retireValue);
+            retireDeferredDestroys();
+        }
+    }
+} // namespace tre
\ No newline at end of file
@@ -16,20 +16,24 @@
 #include <iostream>
 #include <stdexcept>
 
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
 namespace fte
 {
 FirstApp::FirstApp()
 {
     globalDescriptorPool = DescriptorPool::Builder(device)
-                               .setMaxSets(Swapchain::MAX_FRAMES_IN_FLIGHT)
-                               .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Swapchain::MAX_FRAMES_IN_FLIGHT)
-                               .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, Swapchain::MAX_FRAMES_IN_FLIGHT)
+                               .setMaxSets(1)
+                               .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
                                .build();
 
-    std::shared_ptr<Model> model = Model::createModelFromFile(device, "assets/models/tiny_frog/model.obj");
-
     auto object = GameObject::createGameObject();
-    object.model = model;
+    object.model = assetLoader.loadModel("assets/models/tiny_frog/model.obj", Model::VertexFormat::Packed);
+    // Models resolve their path against ENGINE_DIR themselves; textures take it as given.
+    object.texture = assetLoader.loadTexture(ENGINE_DIR "assets/models/tiny_frog/textures/baseColor.png",
+                                             Texture::Compression::BC7);
 
     object.transform.translation = {0.0f, 0.0f, 0.0f};
     object.transform.scale = {3.0f, 3.0f, 3.0f};
@@ -41,55 +45,74 @@ FirstApp::~FirstApp()
 {
 }
 
-void FirstApp::run()
+// Reports each failed load once, then keeps the placeholder as a resident handle so the
+// object stops being reported. The loader has already logged the cause.
+void FirstApp::reportFailedAssets()
 {
-    std::vector<std::unique_ptr<Buffer>> uboBuffers(Swapchain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < uboBuffers.size(); i++)
+    for (auto &[id, obj] : gameObjects)
     {
-        uboBuffers[i] = std::make_unique<Buffer>(device, sizeof(GlobalUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-        uboBuffers[i]->map();
+        if (obj.model.hasFailed())
+        {
+            std::cerr << "game object " << id << " has no model, drawing the placeholder" << std::endl;
+            obj.model = obj.model.share();
+        }
+        if (obj.texture.hasFailed())
+        {
+            std::cerr << "game object " << id << " has no texture, drawing the placeholder" << std::endl;
+            obj.texture = obj.texture.share();
+        }
     }
+}
 
+void FirstApp::run()
+{
     auto globalSetLayout = DescriptorSetLayout::Builder(device)
-                               .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-                               .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                               .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
                                .build();
 
-    Texture texture(device, "../assets/models/tiny_frog/textures/baseColor.png");
-
-    VkDescriptorImageInfo imageInfo = {};
-    imageInfo.sampler = texture.getSampler();
-    imageInfo.imageLayout = texture.getImageLayout();
-    imageInfo.imageView = texture.getImageView();
-
-    std::vector<VkDescriptorSet> globalDescriptorSets(Swapchain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < globalDescriptorSets.size(); i++)
-    {
-        auto bufferInfo = uboBuffers[i]->descriptorInfo();
-        DescriptorWriter(*globalSetLayout, *globalDescriptorPool)
-            .writeBuffer(0, &bufferInfo)
-            .writeImage(1, &imageInfo)
-            .build(globalDescriptorSets[i]);
-    }
+    // One set for every frame: the UBO is pushed into the renderer's frame allocator and
+    // selected with a dynamic offset. Textures live in bindlessTextures' set.
+    FrameAllocator &frameAllocator = renderer.getFrameAllocator();
+    VkDescriptorSet globalDescriptorSet;
+    auto bufferInfo = frameAllocator.descriptorInfo(sizeof(GlobalUbo));
+    DescriptorWriter(*globalSetLayout, *globalDescriptorPool)
+        .writeBuffer(0, &bufferInfo)
+        .build(globalDescriptorSet);
 
     SimpleRenderSystem simpleRenderSystem{device, renderer.getSwapchainRenderPass(),
-                                          globalSetLayout->getDescriptorSetLayout()};
+                                          globalSetLayout->getDescriptorSetLayout(), bindlessTextures};
 
     Camera camera;
 
     auto viewerObject = GameObject::createGameObject();
     viewerObject.transform.translation.z = 1.0f;
 
+    // Seconds between memory budget log lines.
+    constexpr float MEMORY_LOG_INTERVAL = 10.0f;
+    float memoryLogTimer = 0.0f;
+
     auto currentTime = std::chrono::steady_clock::now();
     while (!window.isQuitRequested())
     {
         window.pollEvents();
+        size_t pendingAssets = assetLoader.getPendingCount();
+        assetLoader.update();
+        if (assetLoader.getPendingCount() != pendingAssets)
+        {
+            reportFailedAssets();
+        }
 
         auto newTime = std::chrono::steady_clock::now();
         float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
         currentTime = newTime;
 
+        memoryLogTimer += frameTime;
+        if (memoryLogTimer >= MEMORY_LOG_INTERVAL)
+        {
+            memoryLogTimer = 0.0f;
+            device.logMemoryBudget();
+        }
+
         camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
         float aspect = renderer.getAspectRatio();
@@ -103,19 +126,30 @@ void FirstApp::run()
         if (auto commandBuffer = renderer.beginFrame())
         {
             int frameIndex = renderer.getFrameIndex();
-            FrameInfo frameInfo = {frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex],
-                                   gameObjects};
 
             GlobalUbo ubo = {};
             ubo.projection = camera.getProjection();
             ubo.view = camera.getView();
             ubo.inverseView = camera.getInverseView();
-            uboBuffers[frameIndex]->writeToBuffer(&ubo);
-            uboBuffers[frameIndex]->flush();
-
-            renderer.beginSwapchainRenderPass(commandBuffer);
-
-            simpleRenderSystem.renderGameObjects(frameInfo);
+            auto uboAllocation = frameAllocator.push(ubo);
+
+            FrameInfo frameInfo = {frameIndex,          frameTime,
+                                   commandBuffer,       camera,
+                                   globalDescriptorSet, uboAllocation.getDynamicOffset(),
+                                   frameAllocator,      gameObjects};
+
+            simpleRenderSystem.prepareGameObjects(frameInfo);
+            if (simpleRenderSystem.shouldRecordInParallel())
+            {
+                renderer.beginSwapchainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                renderer.executeSecondaryCommandBuffers(commandBuffer,
+                                                        simpleRenderSystem.recordGameObjects(frameInfo, renderer));
+            }
+            else
+            {
+                renderer.beginSwapchainRenderPass(commandBuffer);
+                simpleRenderSystem.renderGameObjects(frameInfo);
+            }
 
             renderer.endSwapchainRenderPass(commandBuffer);
             renderer.endFrame();
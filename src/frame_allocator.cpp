@@ -0,0 +1,118 @@
+#include "frame_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace fte {
+namespace {
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+FrameAllocator::FrameAllocator(Device& device, uint32_t frameCount, VkDeviceSize frameCapacity)
+    : treDevice { device }
+    , uniformAlignment { std::max<VkDeviceSize>(device.properties.limits.minUniformBufferOffsetAlignment, 1) }
+{
+    // Every frame's region starts on a uniform offset boundary.
+    this->frameCapacity = alignUp(frameCapacity, uniformAlignment);
+
+    buffer = createBuffer(this->frameCapacity, frameCount);
+    overflowBlocks.resize(frameCount);
+}
+
+std::unique_ptr<Buffer> FrameAllocator::createBuffer(VkDeviceSize size, uint32_t instanceCount)
+{
+    auto newBuffer = std::make_unique<Buffer>(
+        treDevice,
+        size,
+        instanceCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    newBuffer->map();
+    return newBuffer;
+}
+
+void FrameAllocator::beginFrame(uint32_t frameIndex)
+{
+    assert(frameIndex < buffer->getInstanceCount() && "Frame index out of range");
+    this->frameIndex = frameIndex;
+    frameStart = frameIndex * frameCapacity;
+    head = 0;
+    flushedHead = 0;
+
+    overflowBlock = 0;
+    for (auto& block : overflowBlocks[frameIndex]) {
+        block.head = 0;
+        block.flushedHead = 0;
+    }
+}
+
+FrameAllocator::Allocation FrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    alignment = alignment == 0 ? uniformAlignment : alignment;
+    VkDeviceSize offset = alignUp(head, alignment);
+    if (offset + size > frameCapacity) {
+        return allocateOverflow(size, alignment);
+    }
+    head = offset + size;
+
+    Allocation allocation {};
+    allocation.buffer = buffer->getBuffer();
+    allocation.offset = frameStart + offset;
+    allocation.size = size;
+    allocation.mapped = static_cast<char*>(buffer->getMappedMemory()) + allocation.offset;
+    return allocation;
+}
+
+FrameAllocator::Allocation FrameAllocator::allocateOverflow(VkDeviceSize size, VkDeviceSize alignment)
+{
+    auto& blocks = overflowBlocks[frameIndex];
+    VkDeviceSize offset = 0;
+    for (; overflowBlock < blocks.size(); overflowBlock++) {
+        offset = alignUp(blocks[overflowBlock].head, alignment);
+        if (offset + size <= blocks[overflowBlock].buffer->getBufferSize()) {
+            break;
+        }
+    }
+    if (overflowBlock == blocks.size()) {
+        // Doubling keeps the block count logarithmic in how far a frame outgrows its region.
+        VkDeviceSize blockSize = std::max(frameCapacity << (blocks.size() + 1), alignUp(size, uniformAlignment));
+        blocks.push_back({ createBuffer(blockSize, 1) });
+        offset = 0;
+    }
+
+    OverflowBlock& block = blocks[overflowBlock];
+    block.head = offset + size;
+
+    Allocation allocation {};
+    allocation.buffer = block.buffer->getBuffer();
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = static_cast<char*>(block.buffer->getMappedMemory()) + offset;
+    return allocation;
+}
+
+FrameAllocator::Allocation FrameAllocator::push(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+{
+    Allocation allocation = allocate(size, alignment);
+    std::memcpy(allocation.mapped, data, size);
+    return allocation;
+}
+
+void FrameAllocator::flush()
+{
+    if (head != flushedHead) {
+        buffer->markDirty(head - flushedHead, frameStart + flushedHead);
+        flushedHead = head;
+    }
+    for (auto& block : overflowBlocks[frameIndex]) {
+        if (block.head != block.flushedHead) {
+            block.buffer->markDirty(block.head - block.flushedHead, block.flushedHead);
+            block.flushedHead = block.head;
+        }
+    }
+}
+} // namespace fte
@@ -0,0 +1,84 @@
+#include "frame_context.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace fte {
+FrameContext::FrameContext(Device& device, uint32_t recordingSlotCount)
+    : treDevice { device }
+    , recordingPools(recordingSlotCount)
+{
+    createPool(mainPool);
+    for (auto& pool : recordingPools) {
+        createPool(pool);
+    }
+}
+
+FrameContext::~FrameContext()
+{
+    // Destroying a pool frees its command buffers.
+    vkDestroyCommandPool(treDevice.getLogicalDevice(), mainPool.commandPool, nullptr);
+    for (auto& pool : recordingPools) {
+        vkDestroyCommandPool(treDevice.getLogicalDevice(), pool.commandPool, nullptr);
+    }
+}
+
+void FrameContext::createPool(CommandPool& pool)
+{
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = treDevice.findQueueFamilies().graphicsFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(treDevice.getLogicalDevice(), &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame command pool!");
+    }
+}
+
+void FrameContext::reset()
+{
+    resetPool(mainPool);
+    for (auto& pool : recordingPools) {
+        resetPool(pool);
+    }
+}
+
+void FrameContext::resetPool(CommandPool& pool)
+{
+    if (pool.usedCount == 0) {
+        return;
+    }
+    // Returns every buffer to the initial state; the pool keeps their memory for reuse.
+    vkResetCommandPool(treDevice.getLogicalDevice(), pool.commandPool, 0);
+    pool.usedCount = 0;
+}
+
+VkCommandBuffer FrameContext::allocatePrimary()
+{
+    return allocate(mainPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+VkCommandBuffer FrameContext::allocateSecondary(uint32_t slot)
+{
+    assert(slot < recordingPools.size() && "Recording slot out of range");
+    return allocate(recordingPools[slot], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+}
+
+VkCommandBuffer FrameContext::allocate(CommandPool& pool, VkCommandBufferLevel level)
+{
+    if (pool.usedCount == pool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = level;
+        allocInfo.commandPool = pool.commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(treDevice.getLogicalDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
+        pool.commandBuffers.push_back(commandBuffer);
+    }
+    return pool.commandBuffers[pool.usedCount++];
+}
+} // namespace fte
@@ -0,0 +1,132 @@
+#include "geometry_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace fte {
+GeometryPool::GeometryPool(Device& device, VkDeviceSize vertexPageSize, VkDeviceSize indexPageSize)
+    : treDevice { device }
+    , vertexPageSize { vertexPageSize }
+    , indexPageSize { indexPageSize }
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+    // Deferred Model destroys free ranges into this pool.
+    treDevice.flushDeferredDestroys();
+}
+
+GeometryPool::Range GeometryPool::allocateVertices(uint32_t vertexSize, uint32_t count)
+{
+    return allocate(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexSize, count, vertexPageSize);
+}
+
+GeometryPool::Range GeometryPool::allocateIndices(VkIndexType indexType, uint32_t count)
+{
+    uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    return allocate(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexSize, count, indexPageSize);
+}
+
+bool GeometryPool::allocateFromPage(Page& page, uint32_t count, uint32_t& first)
+{
+    // First fit; meshes are loaded in bulk and rarely freed, so fragmentation stays low.
+    for (auto it = page.freeBlocks.begin(); it != page.freeBlocks.end(); ++it) {
+        if (it->second < count) {
+            continue;
+        }
+        first = it->first;
+        uint32_t remaining = it->second - count;
+        page.freeBlocks.erase(it);
+        if (remaining > 0) {
+            page.freeBlocks.emplace(first + count, remaining);
+        }
+        return true;
+    }
+    return false;
+}
+
+GeometryPool::Range GeometryPool::allocate(
+    VkBufferUsageFlags usage, uint32_t elementSize, uint32_t count, VkDeviceSize pageSize)
+{
+    assert(count > 0 && "Cannot allocate an empty geometry range");
+
+    Range range {};
+    range.count = count;
+    range.elementSize = elementSize;
+
+    for (uint32_t i = 0; i < pages.size(); i++) {
+        Page& page = pages[i];
+        if (page.usage == usage && page.elementSize == elementSize && allocateFromPage(page, count, range.first)) {
+            range.buffer = page.buffer->getBuffer();
+            range.page = i;
+            return range;
+        }
+    }
+
+    // Meshes larger than a page get a page of their own size.
+    uint32_t capacity = static_cast<uint32_t>(std::max<VkDeviceSize>(pageSize / elementSize, count));
+
+    Page page {};
+    page.usage = usage;
+    page.elementSize = elementSize;
+    page.capacity = capacity;
+    page.buffer = std::make_unique<Buffer>(
+        treDevice,
+        elementSize,
+        capacity,
+        usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    page.freeBlocks.emplace(0, capacity);
+
+    if (!allocateFromPage(page, count, range.first)) {
+        throw std::runtime_error("failed to allocate geometry range!");
+    }
+    range.buffer = page.buffer->getBuffer();
+    range.page = static_cast<uint32_t>(pages.size());
+    pages.push_back(std::move(page));
+    return range;
+}
+
+void GeometryPool::free(Range& range)
+{
+    if (!range.isValid()) {
+        return;
+    }
+
+    Page& page = pages[range.page];
+    assert(page.buffer->getBuffer() == range.buffer && "Range does not belong to this pool");
+
+    // Merge with the neighbouring free blocks.
+    uint32_t first = range.first;
+    uint32_t count = range.count;
+    auto next = page.freeBlocks.lower_bound(first);
+    if (next != page.freeBlocks.end() && first + count == next->first) {
+        count += next->second;
+        next = page.freeBlocks.erase(next);
+    }
+    if (next != page.freeBlocks.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == first) {
+            first = previous->first;
+            count += previous->second;
+            page.freeBlocks.erase(previous);
+        }
+    }
+    page.freeBlocks.emplace(first, count);
+
+    range = {};
+}
+
+UploadManager::Token GeometryPool::upload(const Range& range, const void* data)
+{
+    assert(range.isValid() && "Cannot upload into an empty geometry range");
+
+    return treDevice.getUploadManager().copyToBuffer(
+        range.buffer,
+        static_cast<VkDeviceSize>(range.elementSize) * range.first,
+        data,
+        static_cast<VkDeviceSize>(range.elementSize) * range.count);
+}
+} // namespace fte
@@ -0,0 +1,376 @@
+#include "ktx2.hpp"
+
+#include "asset_file_system.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace fte {
+namespace {
+    constexpr uint8_t IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "KTX2 header must be 80 bytes");
+
+    struct LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // Khronos Data Format constants used by the basic descriptor block below.
+    constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1;
+    constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+    constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+    constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+    constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+    constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_SIGNED = 0x40;
+
+    struct Sample {
+        uint32_t channel;
+        uint32_t bitOffset;
+        uint32_t bitLength;
+    };
+
+    // Basic data format descriptor, prefixed with its total size as KTX2 stores it.
+    std::vector<uint32_t> buildDataFormatDescriptor(VkFormat format, uint32_t blockSize, uint32_t blockExtent)
+    {
+        uint32_t model = KHR_DF_MODEL_RGBSDA;
+        bool srgb = false;
+        bool isSigned = false;
+        std::vector<Sample> samples;
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC1A;
+            samples = { { 0, 0, 64 } };
+            break;
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC1A;
+            samples = { { 1, 0, 64 } }; // KHR_DF_CHANNEL_BC1A_ALPHAPRESENT
+            break;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC3;
+            samples = { { 15, 0, 64 }, { 0, 64, 64 } };
+            break;
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+            isSigned = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC5;
+            samples = { { 0, 0, 64 }, { 1, 64, 64 } };
+            break;
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC7;
+            samples = { { 0, 0, 128 } };
+            break;
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            srgb = true;
+            [[fallthrough]];
+        default:
+            samples = { { 0, 0, 8 }, { 1, 8, 8 }, { 2, 16, 8 }, { 15, 24, 8 } };
+            break;
+        }
+
+        uint32_t blockWords = 6 + 4 * static_cast<uint32_t>(samples.size());
+        std::vector<uint32_t> words;
+        words.push_back(4 * (1 + blockWords));
+        words.push_back(0); // vendorId 0 (Khronos), descriptorType 0 (basic)
+        words.push_back(2 | ((4 * blockWords) << 16)); // versionNumber 2, descriptorBlockSize
+        words.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8)
+            | ((srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+        words.push_back((blockExtent - 1) | ((blockExtent - 1) << 8));
+        words.push_back(blockSize); // bytesPlane0
+        words.push_back(0);
+
+        for (const Sample& sample : samples) {
+            uint32_t channelType = sample.channel | (isSigned ? KHR_DF_SAMPLE_DATATYPE_SIGNED : 0);
+            // The sRGB curve never applies to alpha.
+            if (srgb && sample.channel == 15) {
+                channelType |= 0x10; // KHR_DF_SAMPLE_DATATYPE_LINEAR
+            }
+            words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (channelType << 24));
+            words.push_back(0); // samplePosition
+            if (isSigned) {
+                words.push_back(0x80000000u);
+                words.push_back(0x7FFFFFFFu);
+            } else {
+                words.push_back(0);
+                words.push_back(sample.bitLength >= 32 ? 0xFFFFFFFFu : (1u << sample.bitLength) - 1);
+            }
+        }
+        return words;
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool Ktx2::hasIdentifier(const uint8_t* data, size_t size)
+{
+    return size >= sizeof(IDENTIFIER) && std::memcmp(data, IDENTIFIER, sizeof(IDENTIFIER)) == 0;
+}
+
+bool Ktx2::getFormatBlockInfo(VkFormat format, uint32_t& blockSize, uint32_t& blockExtent)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        blockSize = 8;
+        blockExtent = 4;
+        return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        blockSize = 16;
+        blockExtent = 4;
+        return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        blockSize = 4;
+        blockExtent = 1;
+        return true;
+    default:
+        return false;
+    }
+}
+
+Texture::ImageData Ktx2::read(const std::string& filePath, KeyValues* keyValues)
+{
+    AssetFile file {};
+    if (!file.open(filePath)) {
+        throw std::runtime_error("failed to open KTX2 file: " + filePath);
+    }
+    if (file.size() < sizeof(Header) || !hasIdentifier(file.data(), file.size())) {
+        throw std::runtime_error("not a KTX2 file: " + filePath);
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(Header));
+
+    VkFormat format = static_cast<VkFormat>(header.vkFormat);
+    uint32_t blockSize = 0;
+    uint32_t blockExtent = 0;
+    if (!getFormatBlockInfo(format, blockSize, blockExtent)) {
+        throw std::runtime_error("unsupported KTX2 format " + std::to_string(header.vkFormat) + ": " + filePath);
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1
+        || header.layerCount > 1 || header.faceCount != 1) {
+        throw std::runtime_error("only single 2D KTX2 images are supported: " + filePath);
+    }
+    if (header.supercompressionScheme != 0) {
+        throw std::runtime_error("supercompressed KTX2 files are not supported: " + filePath);
+    }
+
+    // levelCount 0 asks the loader to generate mips, which block-compressed data can't use.
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    uint32_t maxLevels = 1;
+    while ((std::max(header.pixelWidth, header.pixelHeight) >> maxLevels) > 0) {
+        maxLevels++;
+    }
+    if (levelCount > maxLevels || file.size() < sizeof(Header) + sizeof(LevelIndex) * uint64_t { levelCount }) {
+        throw std::runtime_error("corrupt KTX2 level index: " + filePath);
+    }
+
+    if (keyValues) {
+        keyValues->clear();
+        if (header.kvdByteOffset > file.size() || header.kvdByteLength > file.size() - header.kvdByteOffset) {
+            throw std::runtime_error("corrupt KTX2 key/value data: " + filePath);
+        }
+
+        // Each entry is a length, a NUL-terminated key and a value, padded to 4 bytes.
+        const uint8_t* entry = file.data() + header.kvdByteOffset;
+        const uint8_t* end = entry + header.kvdByteLength;
+        while (end - entry >= 4) {
+            uint32_t length;
+            std::memcpy(&length, entry, sizeof(length));
+            if (length > static_cast<size_t>(end - entry - 4)) {
+                throw std::runtime_error("corrupt KTX2 key/value data: " + filePath);
+            }
+
+            const char* text = reinterpret_cast<const char*>(entry + 4);
+            const char* keyEnd = std::find(text, text + length, '\0');
+            if (keyEnd != text + length) {
+                const char* valueEnd = text + length;
+                if (valueEnd > keyEnd + 1 && valueEnd[-1] == '\0') {
+                    valueEnd--;
+                }
+                (*keyValues)[std::string(text, keyEnd)] = std::string(keyEnd + 1, valueEnd);
+            }
+            entry += alignUp(4 + uint64_t { length }, 4);
+        }
+    }
+
+    Texture::ImageData image {};
+    image.width = static_cast<int>(header.pixelWidth);
+    image.height = static_cast<int>(header.pixelHeight);
+    image.format = format;
+    image.levels.resize(levelCount);
+
+    // Levels are packed largest first so a single staging copy keeps them in order.
+    VkDeviceSize totalSize = 0;
+    std::vector<LevelIndex> levelIndex(levelCount);
+    std::memcpy(levelIndex.data(), file.data() + sizeof(Header), sizeof(LevelIndex) * levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        uint32_t width = std::max(header.pixelWidth >> level, 1u);
+        uint32_t height = std::max(header.pixelHeight >> level, 1u);
+        uint64_t expectedSize = uint64_t { (width + blockExtent - 1) / blockExtent }
+            * ((height + blockExtent - 1) / blockExtent) * blockSize;
+
+        const LevelIndex& entry = levelIndex[level];
+        if (entry.byteLength != expectedSize || entry.byteOffset > file.size()
+            || entry.byteLength > file.size() - entry.byteOffset) {
+            throw std::runtime_error("corrupt KTX2 level " + std::to_string(level) + ": " + filePath);
+        }
+
+        auto& mip = image.levels[level];
+        mip.offset = totalSize;
+        mip.size = entry.byteLength;
+        mip.width = width;
+        mip.height = height;
+        totalSize += (entry.byteLength + 15) & ~VkDeviceSize { 15 };
+    }
+
+    image.pixels.resize(totalSize);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        std::memcpy(image.pixels.data() + image.levels[level].offset,
+            file.data() + levelIndex[level].byteOffset, levelIndex[level].byteLength);
+    }
+    return image;
+}
+
+bool Ktx2::write(const std::string& filePath, const Texture::ImageData& image, const KeyValues& keyValues)
+{
+    uint32_t blockSize = 0;
+    uint32_t blockExtent = 0;
+    if (image.levels.empty() || !getFormatBlockInfo(image.format, blockSize, blockExtent)) {
+        std::cerr << "cannot write " << filePath << " as KTX2: unsupported format or no levels" << std::endl;
+        return false;
+    }
+
+    const uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+    const std::vector<uint32_t> dfd = buildDataFormatDescriptor(image.format, blockSize, blockExtent);
+
+    std::vector<uint8_t> kvd;
+    for (const auto& [key, value] : keyValues) { // std::map keeps the keys sorted, as KTX2 requires
+        uint32_t length = static_cast<uint32_t>(key.size() + 1 + value.size() + 1);
+        const uint8_t* lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+        kvd.insert(kvd.end(), lengthBytes, lengthBytes + sizeof(length));
+        kvd.insert(kvd.end(), key.begin(), key.end());
+        kvd.push_back(0);
+        kvd.insert(kvd.end(), value.begin(), value.end());
+        kvd.push_back(0);
+        kvd.resize(alignUp(kvd.size(), 4), 0);
+    }
+
+    Header header {};
+    std::memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+    header.vkFormat = static_cast<uint32_t>(image.format);
+    header.typeSize = 1;
+    header.pixelWidth = static_cast<uint32_t>(image.width);
+    header.pixelHeight = static_cast<uint32_t>(image.height);
+    header.faceCount = 1;
+    header.levelCount = levelCount;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + sizeof(LevelIndex) * levelCount);
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+    header.kvdByteOffset = kvd.empty() ? 0 : header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+    // Level data runs from the smallest mip to the largest, each aligned to
+    // lcm(block size, 4).
+    const uint64_t mipPadding = std::lcm<uint64_t>(blockSize, 4);
+    std::vector<LevelIndex> levelIndex(levelCount);
+    uint64_t offset = uint64_t { header.dfdByteOffset } + header.dfdByteLength + header.kvdByteLength;
+    for (uint32_t level = levelCount; level-- > 0;) {
+        offset = alignUp(offset, mipPadding);
+        levelIndex[level].byteOffset = offset;
+        levelIndex[level].byteLength = image.levels[level].size;
+        levelIndex[level].uncompressedByteLength = image.levels[level].size;
+        offset += image.levels[level].size;
+    }
+
+    std::string tempPath = makeTempPath(filePath);
+    {
+        std::ofstream out { tempPath, std::ios::binary | std::ios::trunc };
+        if (!out) {
+            std::cerr << "failed to create " << tempPath << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(levelIndex.data()), sizeof(LevelIndex) * levelCount);
+        out.write(reinterpret_cast<const char*>(dfd.data()), header.dfdByteLength);
+        out.write(reinterpret_cast<const char*>(kvd.data()), header.kvdByteLength);
+
+        uint64_t written = uint64_t { header.dfdByteOffset } + header.dfdByteLength + header.kvdByteLength;
+        const char padding[16] {};
+        for (uint32_t level = levelCount; level-- > 0;) {
+            out.write(padding, levelIndex[level].byteOffset - written);
+            out.write(reinterpret_cast<const char*>(image.pixels.data() + image.levels[level].offset),
+                image.levels[level].size);
+            written = levelIndex[level].byteOffset + levelIndex[level].byteLength;
+        }
+
+        if (!out) {
+            std::cerr << "failed to write " << tempPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, filePath, error);
+    if (error) {
+        std::cerr << "failed to move " << filePath << " into place: " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+} // namespace fte
@@ -0,0 +1,199 @@
+#include "lz4.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace fte {
+namespace {
+    constexpr size_t MIN_MATCH = 4;
+    // Block format end conditions: the last 5 bytes are always literals and the last
+    // match starts at least 12 bytes before the end.
+    constexpr size_t LAST_LITERALS = 5;
+    constexpr size_t MATCH_FIND_LIMIT = 12;
+    constexpr size_t MAX_DISTANCE = 65535;
+    constexpr uint32_t HASH_LOG = 14;
+    // Like the reference encoder, step faster through data that keeps failing to match.
+    constexpr uint32_t SKIP_TRIGGER = 6;
+
+    uint32_t read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hashPosition(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_LOG);
+    }
+
+    bool writeLength(uint8_t*& op, const uint8_t* end, size_t length)
+    {
+        for (; length >= 255; length -= 255) {
+            if (op == end) {
+                return false;
+            }
+            *op++ = 255;
+        }
+        if (op == end) {
+            return false;
+        }
+        *op++ = static_cast<uint8_t>(length);
+        return true;
+    }
+
+    bool readLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+    {
+        uint8_t byte;
+        do {
+            if (ip == end) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // matchLength == 0 emits the trailing literal-only sequence.
+    bool writeSequence(uint8_t*& op, const uint8_t* end, const uint8_t* literals, size_t literalLength,
+        size_t offset, size_t matchLength)
+    {
+        if (op == end) {
+            return false;
+        }
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+        if (literalLength >= 15 && !writeLength(op, end, literalLength - 15)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - op) < literalLength) {
+            return false;
+        }
+        std::memcpy(op, literals, literalLength);
+        op += literalLength;
+
+        if (matchLength == 0) {
+            return true;
+        }
+        if (end - op < 2) {
+            return false;
+        }
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        size_t code = matchLength - MIN_MATCH;
+        *token |= static_cast<uint8_t>(code < 15 ? code : 15);
+        return code < 15 || writeLength(op, end, code - 15);
+    }
+}
+
+size_t Lz4::compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+    uint8_t* op = dst;
+    const uint8_t* opEnd = dst + dstCapacity;
+    size_t anchor = 0;
+
+    if (srcSize > MATCH_FIND_LIMIT) {
+        std::vector<uint32_t> table(size_t { 1 } << HASH_LOG, 0);
+        const size_t lastMatchStart = srcSize - MATCH_FIND_LIMIT;
+        const size_t matchLimit = srcSize - LAST_LITERALS;
+
+        size_t ip = 0;
+        uint32_t misses = 0;
+        while (ip <= lastMatchStart) {
+            uint32_t sequence = read32(src + ip);
+            uint32_t& slot = table[hashPosition(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(ip);
+
+            if (candidate >= ip || ip - candidate > MAX_DISTANCE || read32(src + candidate) != sequence) {
+                ip += 1 + (misses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1]) {
+                ip--;
+                candidate--;
+            }
+            size_t length = MIN_MATCH;
+            while (ip + length < matchLimit && src[candidate + length] == src[ip + length]) {
+                length++;
+            }
+
+            if (!writeSequence(op, opEnd, src + anchor, ip - anchor, ip - candidate, length)) {
+                return 0;
+            }
+            ip += length;
+            anchor = ip;
+            if (ip - 2 <= lastMatchStart) {
+                table[hashPosition(read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+            }
+        }
+    }
+
+    if (!writeSequence(op, opEnd, src + anchor, srcSize - anchor, 0, 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(op - dst);
+}
+
+bool Lz4::decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    const uint8_t* ip = src;
+    const uint8_t* ipEnd = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + dstSize;
+
+    for (;;) {
+        if (ip == ipEnd) {
+            return false;
+        }
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, ipEnd, literalLength)) {
+            return false;
+        }
+        if (literalLength > static_cast<size_t>(ipEnd - ip) || literalLength > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == ipEnd) {
+            return op == opEnd;
+        }
+
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (size_t { ip[1] } << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(ip, ipEnd, matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // Overlapping copy repeats the last offset bytes.
+            for (size_t i = 0; i < matchLength; i++) {
+                *op++ = match[i];
+            }
+        }
+    }
+}
+} // namespace fte
@@ -1,11 +1,19 @@
+#include "asset_file_system.hpp"
 #include "first_app.hpp"
 
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
 int main()
 {
+    // Optional archive built by fte_packer; anything it lacks is read from the loose files.
+    fte::AssetFileSystem::shared().mount(ENGINE_DIR "assets.fta", ENGINE_DIR);
+
     fte::FirstApp app {};
 
     try {
@@ -16,4 +24,4 @@ int main()
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
\ No newline at end of file
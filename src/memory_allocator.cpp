@@ -0,0 +1,443 @@
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace fte {
+namespace {
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+struct MemoryAllocator::Block {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;
+    uint32_t heapIndex = 0;
+    std::unique_ptr<TlsfAllocator> tlsf; // null for transient blocks
+    VkDeviceSize linearHead = 0;
+    uint32_t linearCount = 0;
+};
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+    : device { device }
+{
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    heaps.resize(memoryProperties.memoryTypeCount * 4);
+    for (uint32_t i = 0; i < heaps.size(); i++) {
+        heaps[i].memoryType = i / 4;
+        heaps[i].transient = (i & 1) != 0;
+    }
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    if (statistics.usedBytes != 0) {
+        std::cerr << "memory allocator destroyed with " << statistics.usedBytes << " bytes still allocated" << std::endl;
+    }
+    for (auto& heap : heaps) {
+        for (auto& block : heap.blocks) {
+            releaseMemory(block->memory, block->size, heap.memoryType);
+        }
+    }
+}
+
+const char* MemoryAllocator::getCategoryName(Category category)
+{
+    switch (category) {
+    case Category::Mesh:
+        return "mesh";
+    case Category::Texture:
+        return "texture";
+    case Category::Attachment:
+        return "attachment";
+    case Category::Staging:
+        return "staging";
+    case Category::Uniform:
+        return "uniform";
+    default:
+        return "other";
+    }
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocateForBuffer(
+    VkBuffer buffer, VkMemoryPropertyFlags properties, Pool pool, Category category)
+{
+    VkBufferMemoryRequirementsInfo2 info {};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    info.buffer = buffer;
+
+    VkMemoryDedicatedRequirements dedicatedRequirements {};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 requirements {};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicatedRequirements;
+    vkGetBufferMemoryRequirements2(device, &info, &requirements);
+
+    VkMemoryDedicatedAllocateInfo dedicatedInfo {};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = buffer;
+
+    // Transient resources only take a preference for dedicated memory as a hint; aliasing wins.
+    bool dedicated = dedicatedRequirements.requiresDedicatedAllocation
+        || (dedicatedRequirements.prefersDedicatedAllocation && pool != Pool::Transient);
+    return allocate(requirements.memoryRequirements, dedicated, &dedicatedInfo, properties, pool, false, category);
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocateForImage(
+    VkImage image, VkMemoryPropertyFlags properties, Pool pool, Category category)
+{
+    VkImageMemoryRequirementsInfo2 info {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    info.image = image;
+
+    VkMemoryDedicatedRequirements dedicatedRequirements {};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 requirements {};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicatedRequirements;
+    vkGetImageMemoryRequirements2(device, &info, &requirements);
+
+    VkMemoryDedicatedAllocateInfo dedicatedInfo {};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.image = image;
+
+    // Every image this engine creates is optimal tiling.
+    bool dedicated = dedicatedRequirements.requiresDedicatedAllocation
+        || (dedicatedRequirements.prefersDedicatedAllocation && pool != Pool::Transient);
+    return allocate(requirements.memoryRequirements, dedicated, &dedicatedInfo, properties, pool, true, category);
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, bool dedicated,
+    const VkMemoryDedicatedAllocateInfo* dedicatedInfo, VkMemoryPropertyFlags properties, Pool pool, bool optimalImage,
+    Category category)
+{
+    std::lock_guard<std::mutex> lock { mutex };
+
+    // A second pass drops LAZILY_ALLOCATED, which is only a preference.
+    VkMemoryPropertyFlags candidates[] = { properties, properties & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT };
+    uint32_t candidateCount = candidates[0] != candidates[1] ? 2 : 1;
+
+    // Memory types are ordered by preference; if one runs out, fall back to the next match.
+    for (uint32_t candidate = 0; candidate < candidateCount; candidate++) {
+        VkMemoryPropertyFlags wanted = candidates[candidate];
+        for (uint32_t memoryType = 0; memoryType < memoryProperties.memoryTypeCount; memoryType++) {
+            VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+            if (!(requirements.memoryTypeBits & (1u << memoryType)) || (flags & wanted) != wanted) {
+                continue;
+            }
+
+            // Keep non-coherent allocations on whole atoms so flushing one never touches another.
+            VkDeviceSize size = requirements.size;
+            VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+            if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+                alignment = std::max(alignment, nonCoherentAtomSize);
+                size = alignUp(size, nonCoherentAtomSize);
+            }
+
+            Allocation allocation {};
+            allocation.memoryType = memoryType;
+            allocation.category = category;
+            VkDeviceSize blockSize = pool == Pool::Transient
+                ? std::min(TRANSIENT_BLOCK_SIZE, getBlockSize(memoryType))
+                : getBlockSize(memoryType);
+            // Transient blocks grow to fit, so attachments of any size are suballocated.
+            if (!dedicated && (pool == Pool::Transient || size <= blockSize / 2)) {
+                uint32_t heapIndex = (memoryType * 2 + (optimalImage ? 1 : 0)) * 2 + (pool == Pool::Transient ? 1 : 0);
+                if (allocateFromHeap(heapIndex, size, alignment, allocation)) {
+                    track(allocation, true);
+                    return allocation;
+                }
+                continue;
+            }
+
+            if (allocateMemory(size, memoryType, dedicated ? dedicatedInfo : nullptr, allocation.memory, allocation.mapped)
+                == VK_SUCCESS) {
+                allocation.size = size;
+                track(allocation, true);
+                return allocation;
+            }
+        }
+    }
+
+    throw std::runtime_error("failed to allocate device memory!");
+}
+
+bool MemoryAllocator::allocateFromHeap(uint32_t heapIndex, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation)
+{
+    BlockHeap& heap = heaps[heapIndex];
+
+    auto suballocate = [&](Block& block) {
+        VkDeviceSize offset;
+        if (block.tlsf) {
+            if (!block.tlsf->allocate(size, alignment, allocation.range)) {
+                return false;
+            }
+            offset = allocation.range.offset;
+            allocation.size = allocation.range.size;
+        } else {
+            // Transient blocks only bump; space comes back when the whole block empties.
+            offset = alignUp(block.linearHead, alignment);
+            if (offset + size > block.size) {
+                return false;
+            }
+            block.linearHead = offset + size;
+            block.linearCount++;
+            allocation.size = size;
+        }
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        allocation.block = &block;
+        return true;
+    };
+
+    if (heap.transient) {
+        if (!heap.blocks.empty() && suballocate(*heap.blocks.back())) {
+            return true;
+        }
+    } else {
+        for (auto& block : heap.blocks) {
+            if (suballocate(*block)) {
+                return true;
+            }
+        }
+    }
+
+    if (heap.transient) {
+        // Empty blocks too small for the new set would otherwise never be freed again.
+        for (auto it = heap.blocks.begin(); it != heap.blocks.end();) {
+            if ((*it)->linearCount == 0) {
+                releaseMemory((*it)->memory, (*it)->size, heap.memoryType);
+                it = heap.blocks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    auto block = std::make_unique<Block>();
+    if (heap.transient) {
+        // Room for the previous block's contents too: once they are recreated, this block
+        // alone holds the whole set and the previous one is released.
+        VkDeviceSize previousUsed = heap.blocks.empty() ? 0 : heap.blocks.back()->linearHead;
+        block->size = std::max(std::min(TRANSIENT_BLOCK_SIZE, getBlockSize(heap.memoryType)),
+            alignUp(previousUsed + alignment + size, TlsfAllocator::GRANULARITY));
+    } else {
+        block->size = getBlockSize(heap.memoryType);
+    }
+    block->heapIndex = heapIndex;
+    if (allocateMemory(block->size, heap.memoryType, nullptr, block->memory, block->mapped) != VK_SUCCESS) {
+        return false;
+    }
+    if (!heap.transient) {
+        block->tlsf = std::make_unique<TlsfAllocator>(block->size);
+    }
+    heap.blocks.push_back(std::move(block));
+    return suballocate(*heap.blocks.back());
+}
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+    if (!allocation.isValid()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock { mutex };
+    track(allocation, false);
+
+    Block* block = allocation.block;
+    if (block == nullptr) {
+        releaseMemory(allocation.memory, allocation.size, allocation.memoryType);
+        allocation = {};
+        return;
+    }
+
+    bool empty;
+    if (block->tlsf) {
+        block->tlsf->free(allocation.range);
+        empty = block->tlsf->isEmpty();
+    } else {
+        empty = --block->linearCount == 0;
+        if (empty) {
+            block->linearHead = 0;
+        }
+    }
+    allocation = {};
+
+    // The last block of a heap stays around even when empty, so a resource that is
+    // destroyed and recreated does not round-trip through vkAllocateMemory. Transient heaps
+    // keep their largest block instead, which was grown to hold a whole set of attachments.
+    BlockHeap& heap = heaps[block->heapIndex];
+    bool release = empty && heap.blocks.size() > 1;
+    if (release && heap.transient) {
+        release = std::any_of(heap.blocks.begin(), heap.blocks.end(), [block](const std::unique_ptr<Block>& other) {
+            return other.get() != block && other->size >= block->size;
+        });
+    }
+    if (release) {
+        auto it = std::find_if(heap.blocks.begin(), heap.blocks.end(),
+            [block](const std::unique_ptr<Block>& candidate) { return candidate.get() == block; });
+        releaseMemory(block->memory, block->size, heap.memoryType);
+        heap.blocks.erase(it);
+    }
+}
+
+bool MemoryAllocator::isCoherent(const Allocation& allocation) const
+{
+    return memoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+VkMappedMemoryRange MemoryAllocator::getAtomRange(
+    const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (size == VK_WHOLE_SIZE) {
+        size = allocation.size - offset;
+    }
+
+    // Non-coherent allocations start and end on whole atoms, so the widened range never
+    // leaves the allocation.
+    VkMappedMemoryRange range {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = allocation.offset + (offset & ~(nonCoherentAtomSize - 1));
+    range.size = std::min(allocation.offset + alignUp(offset + size, nonCoherentAtomSize),
+                     allocation.offset + allocation.size)
+        - range.offset;
+    return range;
+}
+
+void MemoryAllocator::markDirty(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (!allocation.isValid() || isCoherent(allocation)) {
+        return;
+    }
+    VkMappedMemoryRange range = getAtomRange(allocation, offset, size);
+
+    std::lock_guard<std::mutex> lock { mutex };
+    dirtyRanges.push_back(range);
+}
+
+VkResult MemoryAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (!allocation.isValid() || isCoherent(allocation)) {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange range = getAtomRange(allocation, offset, size);
+    return vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+VkResult MemoryAllocator::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    if (!allocation.isValid() || isCoherent(allocation)) {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange range = getAtomRange(allocation, offset, size);
+    return vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+VkResult MemoryAllocator::flushMappedRanges()
+{
+    std::lock_guard<std::mutex> lock { mutex };
+    if (dirtyRanges.empty()) {
+        return VK_SUCCESS;
+    }
+
+    std::sort(dirtyRanges.begin(), dirtyRanges.end(), [](const VkMappedMemoryRange& a, const VkMappedMemoryRange& b) {
+        return a.memory != b.memory ? a.memory < b.memory : a.offset < b.offset;
+    });
+    size_t count = 0;
+    for (const auto& range : dirtyRanges) {
+        if (count > 0) {
+            VkMappedMemoryRange& last = dirtyRanges[count - 1];
+            if (last.memory == range.memory && range.offset <= last.offset + last.size) {
+                last.size = std::max(last.offset + last.size, range.offset + range.size) - last.offset;
+                continue;
+            }
+        }
+        dirtyRanges[count++] = range;
+    }
+
+    VkResult result = vkFlushMappedMemoryRanges(device, static_cast<uint32_t>(count), dirtyRanges.data());
+    dirtyRanges.clear();
+    return result;
+}
+
+VkResult MemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext,
+    VkDeviceMemory& memory, void*& mapped)
+{
+    VkMemoryAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = pNext;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (result != VK_SUCCESS) {
+            vkFreeMemory(device, memory, nullptr);
+            memory = VK_NULL_HANDLE;
+            return result;
+        }
+    }
+
+    statistics.deviceMemoryCount++;
+    statistics.reservedBytes += size;
+    statistics.heapReservedBytes[memoryProperties.memoryTypes[memoryType].heapIndex] += size;
+    return VK_SUCCESS;
+}
+
+void MemoryAllocator::releaseMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType)
+{
+    // Freeing implicitly unmaps; queued flushes of this memory no longer matter.
+    dirtyRanges.erase(std::remove_if(dirtyRanges.begin(), dirtyRanges.end(),
+                          [memory](const VkMappedMemoryRange& range) { return range.memory == memory; }),
+        dirtyRanges.end());
+    vkFreeMemory(device, memory, nullptr);
+    statistics.deviceMemoryCount--;
+    statistics.reservedBytes -= size;
+    statistics.heapReservedBytes[memoryProperties.memoryTypes[memoryType].heapIndex] -= size;
+}
+
+void MemoryAllocator::track(const Allocation& allocation, bool allocated)
+{
+    VkDeviceSize& categoryBytes = statistics.categoryBytes[static_cast<uint32_t>(allocation.category)];
+    VkDeviceSize& heapBytes = statistics.heapUsedBytes[memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+    if (allocated) {
+        statistics.usedBytes += allocation.size;
+        categoryBytes += allocation.size;
+        heapBytes += allocation.size;
+    } else {
+        statistics.usedBytes -= allocation.size;
+        categoryBytes -= allocation.size;
+        heapBytes -= allocation.size;
+    }
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType) const
+{
+    // Small heaps (e.g. the 256 MiB host-visible device-local window) get smaller blocks.
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return std::min(DEFAULT_BLOCK_SIZE, (heapSize / 8) & ~(TlsfAllocator::GRANULARITY - 1));
+}
+
+MemoryAllocator::Statistics MemoryAllocator::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock { mutex };
+    return statistics;
+}
+} // namespace fte
@@ -0,0 +1,164 @@
+#include "mesh_cache.hpp"
+
+#include "asset_file_system.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fte {
+namespace {
+    constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+bool MeshCache::write(const std::string& cachePath, const Model::Builder& builder,
+    uint64_t sourceHash, uint64_t sourceSize, int64_t sourceMtime)
+{
+    Header header {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.vertexStride = sizeof(Model::Vertex);
+    header.indexStride = sizeof(uint32_t);
+    header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+    header.indexCount = static_cast<uint32_t>(builder.indices.size());
+    header.meshletStride = sizeof(Model::Meshlet);
+    header.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+    header.lodStride = sizeof(Model::Lod);
+    header.lodCount = static_cast<uint32_t>(builder.lods.size());
+    header.vertexOffset = alignUp(sizeof(Header), BLOB_ALIGNMENT);
+    header.indexOffset = alignUp(header.vertexOffset + uint64_t { header.vertexStride } * header.vertexCount, BLOB_ALIGNMENT);
+    header.meshletOffset = alignUp(header.indexOffset + uint64_t { header.indexStride } * header.indexCount, BLOB_ALIGNMENT);
+    header.lodOffset = alignUp(header.meshletOffset + uint64_t { header.meshletStride } * header.meshletCount, BLOB_ALIGNMENT);
+    header.fileSize = header.lodOffset + uint64_t { header.lodStride } * header.lodCount;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.sourceMtime = sourceMtime;
+
+    glm::vec3 boundsMin { 0.0f };
+    glm::vec3 boundsMax { 0.0f };
+    if (!builder.vertices.empty()) {
+        boundsMin = boundsMax = builder.vertices[0].position;
+        for (const auto& vertex : builder.vertices) {
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = boundsMin[i];
+        header.boundsMax[i] = boundsMax[i];
+    }
+
+    // Write next to the destination and rename so a crash never leaves a torn cache behind.
+    std::string tempPath = makeTempPath(cachePath);
+    {
+        std::ofstream out { tempPath, std::ios::binary | std::ios::trunc };
+        if (!out) {
+            std::cerr << "failed to create mesh cache " << tempPath << std::endl;
+            return false;
+        }
+
+        const char padding[BLOB_ALIGNMENT] {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(padding, header.vertexOffset - sizeof(header));
+        out.write(reinterpret_cast<const char*>(builder.vertices.data()),
+            uint64_t { header.vertexStride } * header.vertexCount);
+        out.write(padding, header.indexOffset - (header.vertexOffset + uint64_t { header.vertexStride } * header.vertexCount));
+        out.write(reinterpret_cast<const char*>(builder.indices.data()),
+            uint64_t { header.indexStride } * header.indexCount);
+        out.write(padding, header.meshletOffset - (header.indexOffset + uint64_t { header.indexStride } * header.indexCount));
+        out.write(reinterpret_cast<const char*>(builder.meshlets.data()),
+            uint64_t { header.meshletStride } * header.meshletCount);
+        out.write(padding, header.lodOffset - (header.meshletOffset + uint64_t { header.meshletStride } * header.meshletCount));
+        out.write(reinterpret_cast<const char*>(builder.lods.data()),
+            uint64_t { header.lodStride } * header.lodCount);
+
+        if (!out) {
+            std::cerr << "failed to write mesh cache " << tempPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::cerr << "failed to move mesh cache into place: " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::updateSourceMtime(const std::string& cachePath, int64_t sourceMtime)
+{
+    std::fstream file { cachePath, std::ios::binary | std::ios::in | std::ios::out };
+    if (file) {
+        file.seekp(offsetof(Header, sourceMtime));
+        file.write(reinterpret_cast<const char*>(&sourceMtime), sizeof(sourceMtime));
+    }
+}
+
+bool MeshCache::open(const std::string& cachePath)
+{
+    fileHeader = nullptr;
+    if (!file.open(cachePath) || file.size() < sizeof(Header)) {
+        file.close();
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const Header*>(file.data());
+    bool valid = header->magic == MAGIC
+        && header->version == VERSION
+        && header->vertexStride == sizeof(Model::Vertex)
+        && header->indexStride == sizeof(uint32_t)
+        && header->meshletStride == sizeof(Model::Meshlet)
+        && header->lodStride == sizeof(Model::Lod)
+        && header->fileSize == file.size()
+        && header->vertexOffset % BLOB_ALIGNMENT == 0
+        && header->indexOffset % BLOB_ALIGNMENT == 0
+        && header->meshletOffset % BLOB_ALIGNMENT == 0
+        && header->lodOffset % BLOB_ALIGNMENT == 0
+        && header->vertexOffset >= sizeof(Header)
+        && header->vertexOffset + uint64_t { header->vertexStride } * header->vertexCount <= header->indexOffset
+        && header->indexOffset + uint64_t { header->indexStride } * header->indexCount <= header->meshletOffset
+        && header->meshletOffset + uint64_t { header->meshletStride } * header->meshletCount <= header->lodOffset
+        && header->lodOffset + uint64_t { header->lodStride } * header->lodCount <= header->fileSize;
+
+    if (!valid) {
+        file.close();
+        return false;
+    }
+
+    fileHeader = header;
+    return true;
+}
+
+const Model::Vertex* MeshCache::vertices() const
+{
+    return reinterpret_cast<const Model::Vertex*>(file.data() + fileHeader->vertexOffset);
+}
+
+const uint32_t* MeshCache::indices() const
+{
+    return reinterpret_cast<const uint32_t*>(file.data() + fileHeader->indexOffset);
+}
+
+const Model::Meshlet* MeshCache::meshlets() const
+{
+    return reinterpret_cast<const Model::Meshlet*>(file.data() + fileHeader->meshletOffset);
+}
+
+const Model::Lod* MeshCache::lods() const
+{
+    return reinterpret_cast<const Model::Lod*>(file.data() + fileHeader->lodOffset);
+}
+} // namespace fte
@@ -0,0 +1,778 @@
+#include "mesh_optimizer.hpp"
+
+#include "vertex_weld_table.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace fte {
+namespace {
+    // Forsyth's scoring parameters, tuned for a 32-entry LRU cache.
+    constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+    constexpr uint32_t MAX_SCORED_VALENCE = 64;
+
+    struct ScoreTables {
+        float cache[FORSYTH_CACHE_SIZE];
+        float valence[MAX_SCORED_VALENCE];
+
+        ScoreTables()
+        {
+            for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+                if (i < 3) {
+                    cache[i] = LAST_TRIANGLE_SCORE;
+                } else {
+                    float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                    cache[i] = std::pow(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+                }
+            }
+            for (uint32_t i = 0; i < MAX_SCORED_VALENCE; i++) {
+                valence[i] = i == 0 ? 0.0f : VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+            }
+        }
+    };
+
+    float vertexScore(const ScoreTables& tables, int cachePosition, uint32_t remainingValence)
+    {
+        if (remainingValence == 0) {
+            return -1.0f;
+        }
+        float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+        return score + tables.valence[std::min(remainingValence, MAX_SCORED_VALENCE - 1)];
+    }
+
+    // Cache misses of a triangle against a FIFO cache; updates the cache in place.
+    uint32_t fifoTriangle(const uint32_t* triangle, std::vector<uint32_t>& timestamps, uint32_t& time, uint32_t cacheSize)
+    {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t vertex = triangle[k];
+            if (time - timestamps[vertex] > cacheSize) {
+                timestamps[vertex] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    // Symmetric 4x4 error quadric (Garland-Heckbert), accumulated with area weights and
+    // normalized by the total weight when evaluated.
+    struct Quadric {
+        double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+        double b0 = 0, b1 = 0, b2 = 0, c = 0;
+        double weight = 0;
+
+        static Quadric fromPlane(double nx, double ny, double nz, double d, double weight)
+        {
+            Quadric q;
+            q.a00 = nx * nx * weight;
+            q.a11 = ny * ny * weight;
+            q.a22 = nz * nz * weight;
+            q.a01 = nx * ny * weight;
+            q.a02 = nx * nz * weight;
+            q.a12 = ny * nz * weight;
+            q.b0 = nx * d * weight;
+            q.b1 = ny * d * weight;
+            q.b2 = nz * d * weight;
+            q.c = d * d * weight;
+            q.weight = weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a00 += other.a00;
+            a11 += other.a11;
+            a22 += other.a22;
+            a01 += other.a01;
+            a02 += other.a02;
+            a12 += other.a12;
+            b0 += other.b0;
+            b1 += other.b1;
+            b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Mean squared distance from p to the accumulated planes.
+        double error(const float* p) const
+        {
+            double x = p[0], y = p[1], z = p[2];
+            double e = a00 * x * x + a11 * y * y + a22 * z * z
+                + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                + 2 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Position {
+        float x, y, z;
+
+        bool operator==(const Position& other) const { return x == other.x && y == other.y && z == other.z; }
+    };
+
+    void triangleNormal(const float* p0, const float* p1, const float* p2, float* n)
+    {
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::analyzeVertexCache(
+    const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    assert(indexCount % 3 == 0);
+
+    VertexCacheStatistics statistics {};
+    if (indexCount == 0 || vertexCount == 0) {
+        return statistics;
+    }
+
+    // Timestamps start far enough in the past that every first use is a miss.
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; i += 3) {
+        statistics.vertexTransforms += fifoTriangle(indices + i, timestamps, time, cacheSize);
+    }
+
+    statistics.acmr = static_cast<float>(statistics.vertexTransforms) / static_cast<float>(indexCount / 3);
+    statistics.atvr = static_cast<float>(statistics.vertexTransforms) / static_cast<float>(vertexCount);
+    return statistics;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    assert(indexCount % 3 == 0);
+
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    static const ScoreTables tables {};
+
+    // Vertex -> triangle adjacency in compressed rows.
+    std::vector<uint32_t> valence(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        valence[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + valence[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i++) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = vertexScore(tables, -1, valence[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> output(indexCount);
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t cacheCount = 0;
+    size_t scanCursor = 0;
+
+    uint32_t bestTriangle = 0;
+    for (size_t t = 1; t < triangleCount; t++) {
+        if (triangleScores[t] > triangleScores[bestTriangle]) {
+            bestTriangle = static_cast<uint32_t>(t);
+        }
+    }
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        const uint32_t* triangle = indices + bestTriangle * 3;
+        std::memcpy(&output[emittedCount * 3], triangle, 3 * sizeof(uint32_t));
+        emitted[bestTriangle] = 1;
+
+        // Push the triangle's vertices to the front of the LRU cache.
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t newCount = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t vertex = triangle[k];
+            newCache[newCount++] = vertex;
+
+            // Remove the triangle from the vertex's adjacency list.
+            uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t* end = begin + valence[vertex];
+            uint32_t* found = std::find(begin, end, bestTriangle);
+            assert(found != end);
+            std::swap(*found, *(end - 1));
+            valence[vertex]--;
+        }
+        for (uint32_t i = 0; i < cacheCount; i++) {
+            uint32_t vertex = cache[i];
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                newCache[newCount++] = vertex;
+            }
+        }
+
+        // Rescore everything that was or is in the cache, and the triangles touching it.
+        for (uint32_t i = 0; i < newCount; i++) {
+            uint32_t vertex = newCache[i];
+            int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            cachePositions[vertex] = position;
+
+            float score = vertexScore(tables, position, valence[vertex]);
+            float delta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            const uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+            for (uint32_t j = 0; j < valence[vertex]; j++) {
+                triangleScores[begin[j]] += delta;
+            }
+        }
+
+        cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+        std::memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+        // The next triangle is the best one adjacent to the cache, or the best remaining
+        // unemitted triangle when the cache has nothing left to offer.
+        float bestScore = -1.0f;
+        bool found = false;
+        for (uint32_t i = 0; i < cacheCount; i++) {
+            uint32_t vertex = cache[i];
+            const uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+            for (uint32_t j = 0; j < valence[vertex]; j++) {
+                uint32_t candidate = begin[j];
+                if (triangleScores[candidate] > bestScore) {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = candidate;
+                    found = true;
+                }
+            }
+        }
+
+        if (!found) {
+            while (scanCursor < triangleCount && emitted[scanCursor]) {
+                scanCursor++;
+            }
+            if (scanCursor == triangleCount) {
+                break;
+            }
+            bestTriangle = static_cast<uint32_t>(scanCursor);
+        }
+    }
+
+    std::memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions,
+    size_t vertexCount, size_t positionStride, float threshold)
+{
+    assert(indexCount % 3 == 0);
+    assert(positionStride % sizeof(float) == 0);
+
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    const size_t floatStride = positionStride / sizeof(float);
+    auto position = [&](uint32_t vertex) { return positions + vertex * floatStride; };
+
+    // Cluster boundaries are where the FIFO cache restarts (every vertex of a triangle
+    // misses); moving clusters around there costs little cache efficiency.
+    constexpr uint32_t cacheSize = 16;
+    std::vector<uint32_t> clusters;
+    {
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        for (size_t t = 0; t < triangleCount; t++) {
+            if (fifoTriangle(indices + t * 3, timestamps, time, cacheSize) == 3 || t == 0) {
+                clusters.push_back(static_cast<uint32_t>(t));
+            }
+        }
+    }
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < indexCount; i++) {
+        const float* p = position(indices[i]);
+        meshCenter[0] += p[0];
+        meshCenter[1] += p[1];
+        meshCenter[2] += p[2];
+    }
+    for (float& c : meshCenter) {
+        c /= static_cast<float>(indexCount);
+    }
+
+    // Sort key: how far the cluster faces away from the mesh center. Clusters on the
+    // outside pointing outwards are drawn first.
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        float centroid[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+        for (size_t t = begin; t < end; t++) {
+            const float* p0 = position(indices[t * 3 + 0]);
+            const float* p1 = position(indices[t * 3 + 1]);
+            const float* p2 = position(indices[t * 3 + 2]);
+
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; k++) {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) * (triangleArea / 3.0f);
+                normal[k] += n[k];
+            }
+            area += triangleArea;
+        }
+
+        float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (area > 0.0f && normalLength > 0.0f) {
+            float key = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                key += (centroid[k] / area - meshCenter[k]) * (normal[k] / normalLength);
+            }
+            sortKeys[c] = key;
+        } else {
+            sortKeys[c] = 0.0f;
+        }
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    for (size_t c = 0; c < order.size(); c++) {
+        order[c] = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+    for (uint32_t c : order) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        output.insert(output.end(), indices + begin * 3, indices + end * 3);
+    }
+
+    float before = analyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr;
+    float after = analyzeVertexCache(output.data(), indexCount, vertexCount, cacheSize).acmr;
+    if (after <= before * threshold) {
+        std::memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+    }
+}
+
+size_t MeshOptimizer::optimizeVertexFetchRemap(
+    std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    remap.assign(vertexCount, ~0u);
+
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t& target = remap[indices[i]];
+        if (target == ~0u) {
+            target = nextVertex++;
+        }
+    }
+    return nextVertex;
+}
+
+std::vector<MeshOptimizer::Meshlet> MeshOptimizer::buildMeshlets(uint32_t* indices, size_t indexCount, const float* positions,
+    size_t vertexCount, size_t positionStride, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    assert(indexCount % 3 == 0);
+    assert(maxVertices >= 3 && maxTriangles >= 1);
+
+    std::vector<Meshlet> meshlets;
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return meshlets;
+    }
+
+    const size_t floatStride = positionStride / sizeof(float);
+    auto position = [&](uint32_t vertex) { return positions + vertex * floatStride; };
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        adjacencyOffsets[indices[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i++) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint8_t> used(triangleCount, 0);
+    std::vector<uint32_t> vertexMarker(vertexCount, ~0u);
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+    size_t seedCursor = 0;
+
+    auto newVertexCount = [&](uint32_t triangle, uint32_t marker) {
+        uint32_t count = 0;
+        for (int k = 0; k < 3; k++) {
+            count += vertexMarker[indices[triangle * 3 + k]] != marker;
+        }
+        return count;
+    };
+
+    while (true) {
+        while (seedCursor < triangleCount && used[seedCursor]) {
+            seedCursor++;
+        }
+        if (seedCursor == triangleCount) {
+            break;
+        }
+
+        const uint32_t marker = static_cast<uint32_t>(meshlets.size());
+        meshletVertices.clear();
+        meshletTriangles.clear();
+
+        auto addTriangle = [&](uint32_t triangle) {
+            used[triangle] = 1;
+            meshletTriangles.push_back(triangle);
+            for (int k = 0; k < 3; k++) {
+                uint32_t vertex = indices[triangle * 3 + k];
+                if (vertexMarker[vertex] != marker) {
+                    vertexMarker[vertex] = marker;
+                    meshletVertices.push_back(vertex);
+                }
+            }
+        };
+        addTriangle(static_cast<uint32_t>(seedCursor));
+
+        // Grow through triangles sharing the most vertices with the meshlet so far; ties
+        // go to the earliest triangle, which keeps the vertex-cache order.
+        while (meshletTriangles.size() < maxTriangles) {
+            uint32_t bestTriangle = ~0u;
+            uint32_t bestCost = 3;
+            for (uint32_t vertex : meshletVertices) {
+                for (uint32_t j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex + 1]; j++) {
+                    uint32_t candidate = adjacency[j];
+                    if (used[candidate]) {
+                        continue;
+                    }
+                    uint32_t cost = newVertexCount(candidate, marker);
+                    if (cost < bestCost || (cost == bestCost && candidate < bestTriangle)) {
+                        bestCost = cost;
+                        bestTriangle = candidate;
+                    }
+                }
+            }
+            if (bestTriangle == ~0u || meshletVertices.size() + bestCost > maxVertices) {
+                break;
+            }
+            addTriangle(bestTriangle);
+        }
+
+        Meshlet meshlet {};
+        meshlet.firstIndex = static_cast<uint32_t>(output.size());
+        meshlet.indexCount = static_cast<uint32_t>(meshletTriangles.size() * 3);
+        for (uint32_t triangle : meshletTriangles) {
+            output.insert(output.end(), indices + triangle * 3, indices + triangle * 3 + 3);
+        }
+
+        // Bounding sphere around the AABB center.
+        float boundsMin[3], boundsMax[3];
+        for (int k = 0; k < 3; k++) {
+            boundsMin[k] = boundsMax[k] = position(meshletVertices[0])[k];
+        }
+        for (uint32_t vertex : meshletVertices) {
+            const float* p = position(vertex);
+            for (int k = 0; k < 3; k++) {
+                boundsMin[k] = std::min(boundsMin[k], p[k]);
+                boundsMax[k] = std::max(boundsMax[k], p[k]);
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            meshlet.center[k] = (boundsMin[k] + boundsMax[k]) * 0.5f;
+        }
+        float radiusSquared = 0.0f;
+        for (uint32_t vertex : meshletVertices) {
+            const float* p = position(vertex);
+            float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+            radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+        }
+        meshlet.radius = std::sqrt(radiusSquared);
+
+        // Normal cone from the (counter-clockwise) face normals.
+        std::vector<float> normals;
+        normals.reserve(meshletTriangles.size() * 3);
+        float axis[3] = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t triangle : meshletTriangles) {
+            const float* p0 = position(indices[triangle * 3 + 0]);
+            const float* p1 = position(indices[triangle * 3 + 1]);
+            const float* p2 = position(indices[triangle * 3 + 2]);
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0.0f) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                normals.push_back(n[k] / length);
+                axis[k] += n[k] / length;
+            }
+        }
+
+        float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        if (axisLength > 0.0f && !normals.empty()) {
+            for (float& a : axis) {
+                a /= axisLength;
+            }
+            float minDot = 1.0f;
+            for (size_t i = 0; i < normals.size(); i += 3) {
+                minDot = std::min(minDot, normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]);
+            }
+            // Cones wider than a hemisphere can always be seen from somewhere.
+            if (minDot > 0.0f) {
+                std::memcpy(meshlet.coneAxis, axis, sizeof(axis));
+                meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+            }
+        }
+
+        meshlets.push_back(meshlet);
+    }
+
+    std::memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+    return meshlets;
+}
+
+size_t MeshOptimizer::simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions,
+    size_t vertexCount, size_t positionStride, size_t targetIndexCount, float targetError, float* resultError)
+{
+    assert(indexCount % 3 == 0);
+
+    const size_t floatStride = positionStride / sizeof(float);
+    auto position = [&](uint32_t vertex) { return positions + vertex * floatStride; };
+
+    std::memcpy(destination, indices, indexCount * sizeof(uint32_t));
+    if (resultError) {
+        *resultError = 0.0f;
+    }
+
+    // Vertices that only differ in attributes share one position, quadric and lock state.
+    std::vector<uint32_t> positionOwner(vertexCount);
+    std::vector<uint32_t> wedgeCount(vertexCount, 0);
+    {
+        VertexWeldTable<Position> table { vertexCount };
+        std::vector<Position> uniquePositions;
+        std::vector<uint32_t> firstVertex;
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            const float* p = position(v);
+            uint32_t id = table.weld({ p[0], p[1], p[2] }, uniquePositions);
+            if (id == firstVertex.size()) {
+                firstVertex.push_back(v);
+            }
+            positionOwner[v] = firstVertex[id];
+            wedgeCount[positionOwner[v]]++;
+        }
+    }
+
+    // Lock seams and open or non-manifold borders, found as half-edges without exactly
+    // one opposite twin.
+    std::vector<uint8_t> locked(vertexCount, 0);
+    {
+        std::vector<uint64_t> halfEdges;
+        halfEdges.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint64_t a = positionOwner[indices[i + k]];
+                uint64_t b = positionOwner[indices[i + (k + 1) % 3]];
+                halfEdges.push_back(a << 32 | b);
+            }
+        }
+        std::sort(halfEdges.begin(), halfEdges.end());
+        for (size_t i = 0; i < halfEdges.size(); i++) {
+            uint64_t edge = halfEdges[i];
+            bool duplicate = (i > 0 && halfEdges[i - 1] == edge) || (i + 1 < halfEdges.size() && halfEdges[i + 1] == edge);
+            uint64_t twin = edge << 32 | edge >> 32;
+            auto range = std::equal_range(halfEdges.begin(), halfEdges.end(), twin);
+            if (duplicate || range.second - range.first != 1) {
+                locked[edge >> 32] = 1;
+                locked[edge & 0xFFFFFFFFu] = 1;
+            }
+        }
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            if (wedgeCount[positionOwner[v]] > 1 || locked[positionOwner[v]]) {
+                locked[v] = 1;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const float* p0 = position(indices[i + 0]);
+        float n[3];
+        triangleNormal(p0, position(indices[i + 1]), position(indices[i + 2]), n);
+        double length = std::sqrt(double(n[0]) * n[0] + double(n[1]) * n[1] + double(n[2]) * n[2]);
+        if (length == 0.0) {
+            continue;
+        }
+        double nx = n[0] / length, ny = n[1] / length, nz = n[2] / length;
+        double d = -(nx * p0[0] + ny * p0[1] + nz * p0[2]);
+        Quadric q = Quadric::fromPlane(nx, ny, nz, d, length * 0.5);
+        for (int k = 0; k < 3; k++) {
+            quadrics[positionOwner[indices[i + k]]] += q;
+        }
+    }
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double error;
+    };
+
+    const double errorLimit = double(targetError) * targetError;
+    double maxError = 0.0;
+    size_t currentIndexCount = indexCount;
+    std::vector<uint32_t> collapseTarget(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses the cheapest independent edges, then rewrites the indices.
+    while (currentIndexCount > targetIndexCount) {
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (size_t i = 0; i < currentIndexCount; i++) {
+            adjacencyOffsets[destination[i] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(currentIndexCount);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < currentIndexCount; i++) {
+                adjacency[fill[destination[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < currentIndexCount; i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t from = destination[i + k];
+                uint32_t to = destination[i + (k + 1) % 3];
+                for (int direction = 0; direction < 2; direction++) {
+                    if (!locked[from]) {
+                        Quadric q = quadrics[from];
+                        q += quadrics[positionOwner[to]];
+                        collapses.push_back({ from, to, q.error(position(to)) });
+                    }
+                    std::swap(from, to);
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            collapseTarget[v] = v;
+        }
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t removedIndices = 0;
+        size_t collapseCount = 0;
+        const size_t removalGoal = currentIndexCount - targetIndexCount;
+        for (const auto& collapse : collapses) {
+            if (collapse.error > errorLimit || removedIndices >= removalGoal) {
+                break;
+            }
+            uint32_t from = collapse.from;
+            uint32_t to = collapse.to;
+            if (touched[positionOwner[from]] || touched[positionOwner[to]]) {
+                continue;
+            }
+
+            // Reject collapses that fold a surviving triangle over.
+            bool flips = false;
+            size_t removedHere = 0;
+            for (uint32_t j = adjacencyOffsets[from]; j < adjacencyOffsets[from + 1] && !flips; j++) {
+                const uint32_t* triangle = destination + adjacency[j] * 3;
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                    removedHere += 3;
+                    continue;
+                }
+                const float* before[3];
+                const float* after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = position(triangle[k]);
+                    after[k] = triangle[k] == from ? position(to) : before[k];
+                }
+                float n0[3], n1[3];
+                triangleNormal(before[0], before[1], before[2], n0);
+                triangleNormal(after[0], after[1], after[2], n1);
+                flips = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            collapseTarget[from] = to;
+            quadrics[positionOwner[to]] += quadrics[from];
+            maxError = std::max(maxError, collapse.error);
+            removedIndices += removedHere;
+            collapseCount++;
+
+            // Freeze the one-ring so later collapses this pass see up to date geometry.
+            for (uint32_t j = adjacencyOffsets[from]; j < adjacencyOffsets[from + 1]; j++) {
+                const uint32_t* triangle = destination + adjacency[j] * 3;
+                for (int k = 0; k < 3; k++) {
+                    touched[positionOwner[triangle[k]]] = 1;
+                }
+            }
+        }
+
+        if (collapseCount == 0) {
+            break;
+        }
+
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < currentIndexCount; i += 3) {
+            uint32_t a = collapseTarget[destination[i + 0]];
+            uint32_t b = collapseTarget[destination[i + 1]];
+            uint32_t c = collapseTarget[destination[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            destination[writeIndex++] = a;
+            destination[writeIndex++] = b;
+            destination[writeIndex++] = c;
+        }
+        currentIndexCount = writeIndex;
+    }
+
+    if (resultError) {
+        *resultError = static_cast<float>(std::sqrt(maxError));
+    }
+    return currentIndexCount;
+}
+} // namespace fte
@@ -1,129 +1,291 @@
 #include "model.hpp"
 
+#include "asset_file_system.hpp"
+#include "mesh_cache.hpp"
+#include "obj_loader.hpp"
 #include "utils.hpp"
+#include "vertex_weld_table.hpp"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
+#include <filesystem>
+#include <limits>
 
 #ifndef ENGINE_DIR
 #define ENGINE_DIR "../"
 #endif
 
-namespace std {
-	template <>
-	struct hash<fte::Model::Vertex> {
-		size_t operator()(fte::Model::Vertex const& vertex) const
+namespace fte {
+	namespace {
+		int16_t packSnorm16(float value)
 		{
-			size_t seed = 0;
-			fte::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
+			return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
 		}
-	};
-}
 
-namespace fte {
-	Model::Model(Device& device, const Model::Builder& builder)
-		: treDevice{ device }
+		uint16_t packUnorm16(float value)
+		{
+			return static_cast<uint16_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+		}
+
+		// Octahedral normal encoding, decoded by octDecode() in simple_shader_packed.vert.
+		glm::vec2 octEncode(glm::vec3 n)
+		{
+			float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+			if (length == 0.0f) {
+				return { 0.0f, 0.0f };
+			}
+			n /= length;
+
+			glm::vec2 encoded{ n.x, n.y };
+			if (n.z < 0.0f) {
+				encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+				encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+			}
+			return encoded;
+		}
+	}
+
+	Model::Model(Device& device, GeometryPool& geometryPool, const Model::Builder& builder, VertexFormat format)
+		: treDevice{ device }, geometryPool{ geometryPool }, vertexFormat{ format }, meshlets{ builder.meshlets }, lods{ builder.lods }
+	{
+		createVertexBuffers(builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()));
+		createIndexBuffers(builder.indices.data(), static_cast<uint32_t>(builder.indices.size()));
+	}
+
+	Model::Model(Device& device, GeometryPool& geometryPool, const MeshCache& cache, VertexFormat format)
+		: treDevice{ device }, geometryPool{ geometryPool }, vertexFormat{ format },
+		meshlets(cache.meshlets(), cache.meshlets() + cache.meshletCount()),
+		lods(cache.lods(), cache.lods() + cache.lodCount())
+	{
+		createVertexBuffers(cache.vertices(), cache.vertexCount());
+		createIndexBuffers(cache.indices(), cache.indexCount());
+	}
+
+	Model::~Model()
 	{
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+		// Frames in flight may still draw from the ranges, and a new upload could overwrite them.
+		treDevice.deferDestroy([&geometryPool = geometryPool, vertexRange = vertexRange, indexRange = indexRange]() mutable {
+			geometryPool.free(vertexRange);
+			geometryPool.free(indexRange);
+		});
 	}
 
-	Model::~Model() {}
+	namespace {
+		struct SourceFile {
+			bool exists = false;
+			uint64_t size = 0;
+			int64_t mtime = 0;
+		};
+
+		// Only stats the source; reading and hashing it is left for when the stats disagree.
+		SourceFile statSourceFile(const std::string& sourcePath)
+		{
+			SourceFile source{};
+			std::error_code error;
+			const uint64_t size = std::filesystem::file_size(sourcePath, error);
+			if (error) {
+				return source;
+			}
+			const auto mtime = std::filesystem::last_write_time(sourcePath, error);
+			if (error) {
+				return source;
+			}
+			source.exists = true;
+			source.size = size;
+			source.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+			return source;
+		}
+
+		uint64_t hashSourceFile(const std::string& sourcePath)
+		{
+			AssetFile file{};
+			return file.open(sourcePath) ? hashBytes(file.data(), file.size()) : 0;
+		}
+
+		// A cache without its source OBJ next to it is trusted as shipped. A matching size and
+		// mtime is trusted without reading the source; a matching size with a new mtime (a touch
+		// or a checkout) falls back to comparing the content hash.
+		bool openCurrentCache(MeshCache& cache, const std::string& sourcePath, const std::string& cachePath,
+			const SourceFile& source)
+		{
+			if (!cache.open(cachePath)) {
+				return false;
+			}
+			if (!source.exists || (cache.header().sourceMtime == source.mtime && cache.header().sourceSize == source.size)) {
+				return true;
+			}
+			if (cache.header().sourceSize != source.size || cache.header().sourceHash != hashSourceFile(sourcePath)) {
+				return false;
+			}
+			MeshCache::updateSourceMtime(cachePath, source.mtime);
+			return true;
+		}
+
+		void buildAndCache(Model::Builder& builder, const std::string& sourcePath, const std::string& cachePath,
+			const SourceFile& source)
+		{
+			builder.loadModel(sourcePath);
+
+			builder.optimize();
+			builder.buildMeshlets();
+			builder.buildLods();
+
+			MeshCache::write(cachePath, builder, source.exists ? hashSourceFile(sourcePath) : 0, source.size, source.mtime);
+		}
+	}
 
 	std::unique_ptr<Model> Model::createModelFromFile(
-		Device& device, const std::string& filepath)
+		Device& device, GeometryPool& geometryPool, const std::string& filepath, VertexFormat format)
 	{
+		const std::string sourcePath = ENGINE_DIR + filepath;
+		const std::string cachePath = MeshCache::cachePathFor(sourcePath);
+		const SourceFile source = statSourceFile(sourcePath);
+
+		MeshCache cache{};
+		if (openCurrentCache(cache, sourcePath, cachePath, source)) {
+			return std::make_unique<Model>(device, geometryPool, cache, format);
+		}
+
 		Builder builder{};
-		builder.loadModel(ENGINE_DIR + filepath);
-		return std::make_unique<Model>(device, builder);
+		buildAndCache(builder, sourcePath, cachePath, source);
+		return std::make_unique<Model>(device, geometryPool, builder, format);
 	}
 
-	void Model::createVertexBuffers(const std::vector<Vertex>& vertices)
+	void Model::Builder::loadFromFile(const std::string& filepath)
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
+		const std::string sourcePath = ENGINE_DIR + filepath;
+		const std::string cachePath = MeshCache::cachePathFor(sourcePath);
+		const SourceFile source = statSourceFile(sourcePath);
+
+		MeshCache cache{};
+		if (openCurrentCache(cache, sourcePath, cachePath, source)) {
+			vertices.assign(cache.vertices(), cache.vertices() + cache.vertexCount());
+			indices.assign(cache.indices(), cache.indices() + cache.indexCount());
+			meshlets.assign(cache.meshlets(), cache.meshlets() + cache.meshletCount());
+			lods.assign(cache.lods(), cache.lods() + cache.lodCount());
+			return;
+		}
 
-		Buffer stagingBuffer{
-			treDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
+		buildAndCache(*this, sourcePath, cachePath, source);
+	}
+
+	void Model::createVertexBuffers(const Vertex* vertices, uint32_t count)
+	{
+		assert(count >= 3 && "Vertex count must be at least 3");
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
+		glm::vec3 boundsMin = vertices[0].position;
+		glm::vec3 boundsMax = vertices[0].position;
+		for (uint32_t i = 1; i < count; i++) {
+			boundsMin = glm::min(boundsMin, vertices[i].position);
+			boundsMax = glm::max(boundsMax, vertices[i].position);
+		}
+		boundingCenter = (boundsMin + boundsMax) * 0.5f;
+		for (uint32_t i = 0; i < count; i++) {
+			boundingRadius = std::max(boundingRadius, glm::length(vertices[i].position - boundingCenter));
+		}
+
+		if (vertexFormat == VertexFormat::Full) {
+			uploadVertexBuffer(vertices, sizeof(Vertex), count);
+			return;
+		}
 
-		vertexBuffer = std::make_unique<Buffer>(
-			treDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3{ 1e-8f });
+		positionDequantization = glm::scale(glm::translate(glm::mat4{ 1.0f }, boundsMin), extent);
+
+		std::vector<PackedVertex> packed(count);
+		for (uint32_t i = 0; i < count; i++) {
+			const Vertex& vertex = vertices[i];
+			glm::vec3 position = (vertex.position - boundsMin) / extent;
+			glm::vec2 normal = octEncode(vertex.normal);
+
+			packed[i].position[0] = packUnorm16(position.x);
+			packed[i].position[1] = packUnorm16(position.y);
+			packed[i].position[2] = packUnorm16(position.z);
+			packed[i].normal[0] = packSnorm16(normal.x);
+			packed[i].normal[1] = packSnorm16(normal.y);
+			packed[i].uv[0] = glm::packHalf1x16(vertex.uv.x);
+			packed[i].uv[1] = glm::packHalf1x16(vertex.uv.y);
+		}
+		uploadVertexBuffer(packed.data(), sizeof(PackedVertex), count);
+	}
 
-		treDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+	void Model::uploadVertexBuffer(const void* vertices, uint32_t vertexSize, uint32_t count)
+	{
+		vertexCount = count;
+		vertexRange = geometryPool.allocateVertices(vertexSize, vertexCount);
+		uploadToken = geometryPool.upload(vertexRange, vertices);
 	}
 
-	void Model::createIndexBuffers(const std::vector<uint32_t>& indices)
+	void Model::createIndexBuffers(const uint32_t* indices, uint32_t count)
 	{
-		indexCount = static_cast<uint32_t>(indices.size());
+		indexCount = count;
 		hasIndexBuffer = indexCount > 0;
 
 		if (!hasIndexBuffer) {
 			return;
 		}
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-		uint32_t indexSize = sizeof(indices[0]);
-
-		Buffer stagingBuffer{
-			treDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
+		if (lods.empty()) {
+			lods.push_back({ 0, indexCount, 0.0f });
+		}
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
+		// Meshes that only address the first 65536 vertices get 16-bit indices.
+		uint32_t maxIndex = *std::max_element(indices, indices + indexCount);
+		indexType = maxIndex <= std::numeric_limits<uint16_t>::max() ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 
-		indexBuffer = std::make_unique<Buffer>(
-			treDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		std::vector<uint16_t> narrowIndices;
+		const void* indexData = indices;
+		if (indexType == VK_INDEX_TYPE_UINT16) {
+			narrowIndices.assign(indices, indices + indexCount);
+			indexData = narrowIndices.data();
+		}
 
-		treDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+		indexRange = geometryPool.allocateIndices(indexType, indexCount);
+		uploadToken = geometryPool.upload(indexRange, indexData);
 	}
 
-	void Model::draw(VkCommandBuffer commandBuffer)
+	void Model::draw(VkCommandBuffer commandBuffer, uint32_t lod)
 	{
 		if (hasIndexBuffer) {
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			const Lod& range = lods[std::min<size_t>(lod, lods.size() - 1)];
+			vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, indexRange.first + range.firstIndex,
+				getVertexOffset(), 0);
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, vertexCount, 1, vertexRange.first, 0);
+		}
+	}
+
+	void Model::drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount)
+	{
+		assert(hasIndexBuffer && "Indirect draws need an index buffer");
+
+		constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		if (treDevice.enabledFeatures.multiDrawIndirect) {
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+			return;
+		}
+
+		for (uint32_t i = 0; i < drawCount; i++) {
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + static_cast<VkDeviceSize>(i) * stride, 1, stride);
 		}
 	}
 
 	void Model::bind(VkCommandBuffer commandBuffer)
 	{
-		VkBuffer buffers[] = { vertexBuffer->getBuffer() };
+		// Ranges are addressed through firstIndex/vertexOffset, so the pool buffers are
+		// bound from their start.
+		VkBuffer buffers[] = { vertexRange.buffer };
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
 		if (hasIndexBuffer) {
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, indexRange.buffer, 0, indexType);
 		}
 	}
 
@@ -148,56 +310,166 @@ namespace fte {
 		return attributeDescriptions;
 	}
 
-	void Model::Builder::loadModel(const std::string& filepath)
+	std::vector<VkVertexInputBindingDescription> Model::PackedVertex::getBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(PackedVertex);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> Model::PackedVertex::getAttributeDescriptions()
 	{
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filepath.c_str())) {
-			throw std::runtime_error(err);
-		}
+		// Locations match Vertex so both layouts share the fragment shader interface.
+		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) });
+		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) });
+		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) });
+
+		return attributeDescriptions;
+	}
+
+	void Model::Builder::loadModel(const std::string& filepath)
+	{
+		ObjLoader::Mesh mesh = ObjLoader::load(filepath);
 
 		vertices.clear();
 		indices.clear();
 
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				Vertex vertex{};
-
-				if (index.vertex_index >= 0) {
-					vertex.position = {
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2],
-					};
-
-					vertex.color = { 1.0f, 1.0f, 1.0f };
-				}
-
-				if (index.normal_index >= 0) {
-					vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2],
-					};
-				}
-
-				if (index.texcoord_index >= 0) {
-					vertex.uv = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						1.0f - attrib.texcoords[2 * index.texcoord_index + 1],
-					};
-				}
-
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-				indices.push_back(uniqueVertices[vertex]);
+		vertices.reserve(mesh.indices.size() / 2);
+		indices.reserve(mesh.indices.size());
+
+		VertexWeldTable<Vertex> uniqueVertices{ mesh.indices.size() };
+		for (const auto& index : mesh.indices) {
+			Vertex vertex{};
+
+			if (index.vertexIndex >= 0) {
+				vertex.position = {
+					mesh.positions[3 * index.vertexIndex + 0],
+					mesh.positions[3 * index.vertexIndex + 1],
+					mesh.positions[3 * index.vertexIndex + 2],
+				};
+
+				vertex.color = { 1.0f, 1.0f, 1.0f };
+			}
+
+			if (index.normalIndex >= 0) {
+				vertex.normal = {
+					mesh.normals[3 * index.normalIndex + 0],
+					mesh.normals[3 * index.normalIndex + 1],
+					mesh.normals[3 * index.normalIndex + 2],
+				};
+			}
+
+			if (index.texcoordIndex >= 0) {
+				vertex.uv = {
+					mesh.texcoords[2 * index.texcoordIndex + 0],
+					1.0f - mesh.texcoords[2 * index.texcoordIndex + 1],
+				};
 			}
+
+			indices.push_back(uniqueVertices.weld(vertex, vertices));
+		}
+	}
+
+	Model::Builder::OptimizationReport Model::Builder::optimize(bool reorderForOverdraw)
+	{
+		OptimizationReport report{};
+		report.before = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		if (indices.empty()) {
+			report.after = report.before;
+			return report;
+		}
+
+		MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		if (reorderForOverdraw) {
+			MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), &vertices[0].position.x,
+				vertices.size(), sizeof(Vertex));
+		}
+
+		std::vector<uint32_t> remap;
+		size_t usedVertexCount = MeshOptimizer::optimizeVertexFetchRemap(remap, indices.data(), indices.size(), vertices.size());
+
+		std::vector<Vertex> fetchOrdered(usedVertexCount);
+		for (size_t i = 0; i < vertices.size(); i++) {
+			if (remap[i] != ~0u) {
+				fetchOrdered[remap[i]] = vertices[i];
+			}
+		}
+		for (auto& index : indices) {
+			index = remap[index];
+		}
+		vertices.swap(fetchOrdered);
+
+		report.after = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		return report;
+	}
+
+	void Model::Builder::buildMeshlets()
+	{
+		meshlets.clear();
+		size_t baseIndexCount = lods.empty() ? indices.size() : lods[0].indexCount;
+		if (baseIndexCount == 0) {
+			return;
+		}
+
+		meshlets = MeshOptimizer::buildMeshlets(indices.data(), baseIndexCount, &vertices[0].position.x,
+			vertices.size(), sizeof(Vertex));
+	}
+
+	void Model::Builder::buildLods(uint32_t maxLodCount)
+	{
+		// Levels that barely shrink or drift this far from the surface are not worth keeping.
+		constexpr float MIN_REDUCTION = 0.85f;
+		constexpr float MAX_RELATIVE_ERROR = 0.05f;
+
+		const uint32_t baseIndexCount = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].indexCount;
+		indices.resize(baseIndexCount);
+		lods.assign(1, { 0, baseIndexCount, 0.0f });
+		if (baseIndexCount == 0) {
+			return;
+		}
+
+		glm::vec3 boundsMin = vertices[0].position;
+		glm::vec3 boundsMax = vertices[0].position;
+		for (const auto& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (const auto& vertex : vertices) {
+			radius = std::max(radius, glm::length(vertex.position - center));
+		}
+		if (radius == 0.0f) {
+			return;
+		}
+
+		// Every level is simplified from LOD 0 so its error is measured against the original.
+		std::vector<uint32_t> base(indices.begin(), indices.end());
+		std::vector<uint32_t> simplified(baseIndexCount);
+		for (uint32_t level = 1; level < maxLodCount; level++) {
+			size_t targetIndexCount = (baseIndexCount >> level) / 3 * 3;
+			float error = 0.0f;
+			size_t count = MeshOptimizer::simplify(simplified.data(), base.data(), base.size(), &vertices[0].position.x,
+				vertices.size(), sizeof(Vertex), targetIndexCount, MAX_RELATIVE_ERROR * radius, &error);
+
+			if (count == 0 || count > lods.back().indexCount * MIN_REDUCTION) {
+				break;
+			}
+
+			MeshOptimizer::optimizeVertexCache(simplified.data(), count, vertices.size());
+
+			Lod lod{};
+			lod.firstIndex = static_cast<uint32_t>(indices.size());
+			lod.indexCount = static_cast<uint32_t>(count);
+			lod.error = std::max(error / radius, lods.back().error);
+			lods.push_back(lod);
+			indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
 		}
 	}
 
@@ -0,0 +1,370 @@
+#include "obj_loader.hpp"
+
+#include "asset_file_system.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace fte {
+namespace {
+    constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+    constexpr uint32_t CHUNKS_PER_THREAD = 4;
+
+    enum RelativeFlags : uint8_t {
+        RELATIVE_VERTEX = 1 << 0,
+        RELATIVE_TEXCOORD = 1 << 1,
+        RELATIVE_NORMAL = 1 << 2,
+    };
+
+    // Records that change which shape faces end up in ("usemtl", "mtllib", "g", "o").
+    // They are replayed in order after the parallel pass, see replayShapes().
+    struct Event {
+        enum class Type { UseMaterial, MaterialLibrary, Group } type;
+        size_t polygonCount;
+        size_t indexCount;
+        std::string argument;
+    };
+
+    // Negative OBJ indices are relative to the attributes parsed so far, which a chunk
+    // only knows locally. They are resolved against the chunk and rebased at merge.
+    struct Fixup {
+        size_t index;
+        uint8_t flags;
+    };
+
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        std::vector<float> positions {};
+        std::vector<float> normals {};
+        std::vector<float> texcoords {};
+        std::vector<ObjLoader::Index> indices {};
+        std::vector<Fixup> fixups {};
+        std::vector<Event> events {};
+        size_t polygonCount = 0;
+    };
+
+    bool isLineBreak(char c)
+    {
+        return c == '\n' || c == '\r';
+    }
+
+    // Same result as atoi() for in-range values, without the locale lookup.
+    int parseInt(const char* s)
+    {
+        while (*s == ' ' || (*s >= '\t' && *s <= '\r')) {
+            s++;
+        }
+        bool negative = false;
+        if (*s == '+' || *s == '-') {
+            negative = *s == '-';
+            s++;
+        }
+        int value = 0;
+        while (*s >= '0' && *s <= '9') {
+            value = value * 10 + (*s - '0');
+            s++;
+        }
+        return negative ? -value : value;
+    }
+
+    // Mirrors tinyobj's fixIndex(), with n being the chunk-local attribute count.
+    int resolveIndex(int idx, size_t localCount, uint8_t relativeFlag, uint8_t& flags)
+    {
+        if (idx > 0) {
+            return idx - 1;
+        }
+        if (idx == 0) {
+            return 0;
+        }
+        flags |= relativeFlag;
+        return static_cast<int>(localCount) + idx;
+    }
+
+    // Mirrors tinyobj's parseTriple(): i, i/j/k, i//k, i/j
+    ObjLoader::Index parseTriple(const char** token, const Chunk& chunk, uint8_t& flags)
+    {
+        ObjLoader::Index index { -1, -1, -1 };
+        flags = 0;
+
+        index.vertexIndex = resolveIndex(parseInt(*token), chunk.positions.size() / 3, RELATIVE_VERTEX, flags);
+        (*token) += strcspn((*token), "/ \t\r");
+        if ((*token)[0] != '/') {
+            return index;
+        }
+        (*token)++;
+
+        if ((*token)[0] == '/') {
+            (*token)++;
+            index.normalIndex = resolveIndex(parseInt(*token), chunk.normals.size() / 3, RELATIVE_NORMAL, flags);
+            (*token) += strcspn((*token), "/ \t\r");
+            return index;
+        }
+
+        index.texcoordIndex = resolveIndex(parseInt(*token), chunk.texcoords.size() / 2, RELATIVE_TEXCOORD, flags);
+        (*token) += strcspn((*token), "/ \t\r");
+        if ((*token)[0] != '/') {
+            return index;
+        }
+
+        (*token)++;
+        index.normalIndex = resolveIndex(parseInt(*token), chunk.normals.size() / 3, RELATIVE_NORMAL, flags);
+        (*token) += strcspn((*token), "/ \t\r");
+        return index;
+    }
+
+    std::string parseName(const char* token)
+    {
+        while (*token != '\0' && std::isspace(static_cast<unsigned char>(*token))) {
+            token++;
+        }
+        const char* end = token;
+        while (*end != '\0' && !std::isspace(static_cast<unsigned char>(*end))) {
+            end++;
+        }
+        return std::string(token, end);
+    }
+
+    void parseLine(const char* line, Chunk& chunk, std::vector<ObjLoader::Index>& face, std::vector<uint8_t>& faceFlags)
+    {
+        const char* token = line + strspn(line, " \t");
+        if (token[0] == '\0' || token[0] == '#') {
+            return;
+        }
+
+        if (token[0] == 'v' && IS_SPACE(token[1])) {
+            token += 2;
+            float x, y, z;
+            tinyobj::parseReal3(&x, &y, &z, &token);
+            chunk.positions.insert(chunk.positions.end(), { x, y, z });
+            return;
+        }
+
+        if (token[0] == 'v' && token[1] == 'n' && IS_SPACE(token[2])) {
+            token += 3;
+            float x, y, z;
+            tinyobj::parseReal3(&x, &y, &z, &token);
+            chunk.normals.insert(chunk.normals.end(), { x, y, z });
+            return;
+        }
+
+        if (token[0] == 'v' && token[1] == 't' && IS_SPACE(token[2])) {
+            token += 3;
+            float x, y;
+            tinyobj::parseReal2(&x, &y, &token);
+            chunk.texcoords.insert(chunk.texcoords.end(), { x, y });
+            return;
+        }
+
+        if (token[0] == 'f' && IS_SPACE(token[1])) {
+            token += 2;
+            token += strspn(token, " \t");
+
+            face.clear();
+            faceFlags.clear();
+            while (!IS_NEW_LINE(token[0])) {
+                uint8_t flags;
+                face.push_back(parseTriple(&token, chunk, flags));
+                faceFlags.push_back(flags);
+                token += strspn(token, " \t\r");
+            }
+
+            // Triangle fan, in the same corner order as tinyobj's triangulation.
+            chunk.polygonCount++;
+            for (size_t k = 2; k < face.size(); k++) {
+                const size_t corners[3] = { 0, k - 1, k };
+                for (size_t corner : corners) {
+                    if (faceFlags[corner] != 0) {
+                        chunk.fixups.push_back({ chunk.indices.size(), faceFlags[corner] });
+                    }
+                    chunk.indices.push_back(face[corner]);
+                }
+            }
+            return;
+        }
+
+        if (strncmp(token, "usemtl", 6) == 0 && IS_SPACE(token[6])) {
+            chunk.events.push_back({ Event::Type::UseMaterial, chunk.polygonCount, chunk.indices.size(), parseName(token + 7) });
+            return;
+        }
+
+        if (strncmp(token, "mtllib", 6) == 0 && IS_SPACE(token[6])) {
+            chunk.events.push_back({ Event::Type::MaterialLibrary, chunk.polygonCount, chunk.indices.size(), std::string(token + 7) });
+            return;
+        }
+
+        if ((token[0] == 'g' || token[0] == 'o') && IS_SPACE(token[1])) {
+            chunk.events.push_back({ Event::Type::Group, chunk.polygonCount, chunk.indices.size(), {} });
+            return;
+        }
+    }
+
+    void parseChunk(Chunk& chunk)
+    {
+        std::string line;
+        std::vector<ObjLoader::Index> face;
+        std::vector<uint8_t> faceFlags;
+
+        const char* cursor = chunk.begin;
+        while (cursor < chunk.end) {
+            const char* lineEnd = cursor;
+            while (lineEnd < chunk.end && !isLineBreak(*lineEnd)) {
+                lineEnd++;
+            }
+            if (lineEnd != cursor) {
+                line.assign(cursor, lineEnd);
+                parseLine(line.c_str(), chunk, face, faceFlags);
+            }
+            cursor = lineEnd + 1;
+        }
+    }
+
+    // tinyobj only keeps faces once their shape is pushed, and silently drops faces that
+    // a "usemtl" exported into a shape which is then closed by "g"/"o" with no new faces.
+    // Replaying the events reproduces exactly which index ranges survive.
+    std::vector<std::pair<size_t, size_t>> replayShapes(const std::vector<Event>& events)
+    {
+        std::vector<std::pair<size_t, size_t>> dropped;
+        std::map<std::string, int> materialMap;
+        std::vector<tinyobj::material_t> materials;
+        tinyobj::MaterialFileReader materialReader { "" };
+
+        int material = -1;
+        size_t shapeStart = 0;
+        size_t groupStart = 0;
+        size_t groupPolygonStart = 0;
+
+        for (const auto& event : events) {
+            switch (event.type) {
+            case Event::Type::UseMaterial: {
+                auto it = materialMap.find(event.argument);
+                int newMaterial = it != materialMap.end() ? it->second : -1;
+                if (newMaterial != material) {
+                    groupStart = event.indexCount;
+                    groupPolygonStart = event.polygonCount;
+                    material = newMaterial;
+                }
+                break;
+            }
+            case Event::Type::MaterialLibrary: {
+                std::stringstream names { event.argument };
+                std::string name;
+                while (std::getline(names, name, ' ')) {
+                    std::string warnings;
+                    if (materialReader(name, &materials, &materialMap, &warnings)) {
+                        break;
+                    }
+                }
+                break;
+            }
+            case Event::Type::Group:
+                if (event.polygonCount == groupPolygonStart && event.indexCount > shapeStart) {
+                    dropped.emplace_back(shapeStart, event.indexCount);
+                }
+                shapeStart = groupStart = event.indexCount;
+                groupPolygonStart = event.polygonCount;
+                break;
+            }
+        }
+        return dropped;
+    }
+}
+
+ObjLoader::Mesh ObjLoader::load(const std::string& filepath, ThreadPool& pool)
+{
+    AssetFile file {};
+    if (!file.open(filepath)) {
+        throw std::runtime_error("failed to open OBJ file: " + filepath);
+    }
+
+    const char* data = reinterpret_cast<const char*>(file.data());
+    const size_t size = file.size();
+
+    size_t maxChunks = static_cast<size_t>(pool.getThreadCount() + 1) * CHUNKS_PER_THREAD;
+    size_t chunkCount = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, maxChunks);
+
+    std::vector<Chunk> chunks(chunkCount);
+    size_t previousEnd = 0;
+    for (size_t i = 0; i < chunkCount; i++) {
+        size_t end = i + 1 == chunkCount ? size : std::max(previousEnd, size * (i + 1) / chunkCount);
+        while (end < size && !isLineBreak(data[end - 1])) {
+            end++;
+        }
+        chunks[i].begin = data + previousEnd;
+        chunks[i].end = data + end;
+        previousEnd = end;
+    }
+
+    pool.parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i) { parseChunk(chunks[i]); });
+
+    Mesh mesh {};
+    size_t positionCount = 0, normalCount = 0, texcoordCount = 0, indexCount = 0;
+    for (const auto& chunk : chunks) {
+        positionCount += chunk.positions.size();
+        normalCount += chunk.normals.size();
+        texcoordCount += chunk.texcoords.size();
+        indexCount += chunk.indices.size();
+    }
+    mesh.positions.reserve(positionCount);
+    mesh.normals.reserve(normalCount);
+    mesh.texcoords.reserve(texcoordCount);
+    mesh.indices.reserve(indexCount);
+
+    std::vector<Event> events;
+    size_t polygonBase = 0;
+    for (auto& chunk : chunks) {
+        const int vertexBase = static_cast<int>(mesh.positions.size() / 3);
+        const int normalBase = static_cast<int>(mesh.normals.size() / 3);
+        const int texcoordBase = static_cast<int>(mesh.texcoords.size() / 2);
+        const size_t indexBase = mesh.indices.size();
+
+        for (const auto& fixup : chunk.fixups) {
+            Index& index = chunk.indices[fixup.index];
+            if (fixup.flags & RELATIVE_VERTEX) {
+                index.vertexIndex += vertexBase;
+            }
+            if (fixup.flags & RELATIVE_NORMAL) {
+                index.normalIndex += normalBase;
+            }
+            if (fixup.flags & RELATIVE_TEXCOORD) {
+                index.texcoordIndex += texcoordBase;
+            }
+        }
+
+        for (auto& event : chunk.events) {
+            event.polygonCount += polygonBase;
+            event.indexCount += indexBase;
+            events.push_back(std::move(event));
+        }
+        polygonBase += chunk.polygonCount;
+
+        mesh.positions.insert(mesh.positions.end(), chunk.positions.begin(), chunk.positions.end());
+        mesh.normals.insert(mesh.normals.end(), chunk.normals.begin(), chunk.normals.end());
+        mesh.texcoords.insert(mesh.texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        mesh.indices.insert(mesh.indices.end(), chunk.indices.begin(), chunk.indices.end());
+    }
+
+    auto dropped = replayShapes(events);
+    if (!dropped.empty()) {
+        std::vector<Index> kept;
+        kept.reserve(mesh.indices.size());
+        size_t cursor = 0;
+        for (const auto& range : dropped) {
+            kept.insert(kept.end(), mesh.indices.begin() + cursor, mesh.indices.begin() + range.first);
+            cursor = range.second;
+        }
+        kept.insert(kept.end(), mesh.indices.begin() + cursor, mesh.indices.end());
+        mesh.indices.swap(kept);
+    }
+
+    return mesh;
+}
+} // namespace fte
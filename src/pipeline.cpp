@@ -1,9 +1,9 @@
 #include "pipeline.hpp"
 
+#include "asset_file_system.hpp"
 #include "model.hpp"
 
 #include <cassert>
-#include <fstream>
 #include <iostream>
 #include <stdexcept>
 
@@ -33,20 +33,14 @@ Pipeline::~Pipeline()
 std::vector<char> Pipeline::readFile(const std::string& filepath)
 {
     std::string enginePath = ENGINE_DIR + filepath;
-    std::ifstream file { enginePath, std::ios::ate | std::ios::binary };
+    AssetFile file {};
 
-    if (!file.is_open()) {
+    if (!file.open(enginePath)) {
         throw std::runtime_error("failed to open file: " + enginePath);
     }
 
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
-    return buffer;
+    const char* data = reinterpret_cast<const char*>(file.data());
+    return std::vector<char>(data, data + file.size());
 }
 
 void Pipeline::createGraphicsPipeline(
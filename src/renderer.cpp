@@ -1,5 +1,8 @@
 #include "renderer.hpp"
 
+#include "thread_pool.hpp"
+#include "upload_manager.hpp"
+
 #include <array>
 #include <cassert>
 #include <stdexcept>
@@ -15,15 +18,15 @@ float srgbToLinear(float c)
 namespace fte
 {
 
-Renderer::Renderer(Window &window, Device &device) : window{window}, device{device}
+Renderer::Renderer(Window &window, Device &device)
+    : window{window}, device{device}, frameAllocator{device, Swapchain::MAX_FRAMES_IN_FLIGHT},
+      recordingSlotCount{ThreadPool::shared().getThreadCount() + 1}
 {
     recreateSwapchain();
-    createCommandBuffers();
-}
-
-Renderer::~Renderer()
-{
-    freeCommandBuffers();
+    for (int i = 0; i < Swapchain::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        frameContexts.push_back(std::make_unique<FrameContext>(device, recordingSlotCount));
+    }
 }
 
 void Renderer::recreateSwapchain()
@@ -55,29 +58,6 @@ void Renderer::recreateSwapchain()
     }
 }
 
-void Renderer::createCommandBuffers()
-{
-    commandBuffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
-
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = device.getCommandPool();
-    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-    if (vkAllocateCommandBuffers(device.getLogicalDevice(), &allocInfo, commandBuffers.data()) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate command buffers!");
-    }
-}
-
-void Renderer::freeCommandBuffers()
-{
-    vkFreeCommandBuffers(device.getLogicalDevice(), device.getCommandPool(),
-                         static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-    commandBuffers.clear();
-}
-
 VkCommandBuffer Renderer::beginFrame()
 {
     assert(!isFrameStarted && "Can't call beginFrame while already in progress");
@@ -95,10 +75,17 @@ VkCommandBuffer Renderer::beginFrame()
     }
 
     isFrameStarted = true;
+    // acquireNextImage waited on this frame's timeline value, so its previous data has been
+    // consumed and its command buffers are no longer pending.
+    frameAllocator.beginFrame(currentFrameIndex);
+    frameContexts[currentFrameIndex]->reset();
+    device.retireDeferredDestroys();
+    currentCommandBuffer = frameContexts[currentFrameIndex]->allocatePrimary();
 
     auto commandBuffer = getCurrentCommandBuffer();
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
     {
@@ -116,6 +103,15 @@ void Renderer::endFrame()
         throw std::runtime_error("failed to record command buffer!");
     }
 
+    // Pending uploads go first so this frame's draws see them.
+    device.getUploadManager().flush();
+    frameAllocator.flush();
+    // One vkFlushMappedMemoryRanges for everything written to non-coherent memory.
+    if (device.getMemoryAllocator().flushMappedRanges() != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to flush mapped memory ranges!");
+    }
+
     auto result = swapchain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.isResized())
     {
@@ -131,7 +127,7 @@ void Renderer::endFrame()
     currentFrameIndex = (currentFrameIndex + 1) % Swapchain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void Renderer::beginSwapchainRenderPass(VkCommandBuffer commandBuffer)
+void Renderer::beginSwapchainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents)
 {
     assert(isFrameStarted && "Can't call beginSwapchainRenderPass if frame is not in progress");
     assert(commandBuffer == getCurrentCommandBuffer() &&
@@ -151,8 +147,17 @@ void Renderer::beginSwapchainRenderPass(VkCommandBuffer commandBuffer)
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+    // Secondary command buffers do not inherit dynamic state; they set their own.
+    if (contents == VK_SUBPASS_CONTENTS_INLINE)
+    {
+        setViewportAndScissor(commandBuffer);
+    }
+}
 
+void Renderer::setViewportAndScissor(VkCommandBuffer commandBuffer)
+{
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -173,4 +178,51 @@ void Renderer::endSwapchainRenderPass(VkCommandBuffer commandBuffer)
     vkCmdEndRenderPass(commandBuffer);
 }
 
+VkCommandBuffer Renderer::beginSecondaryCommandBuffer(uint32_t slot)
+{
+    assert(isFrameStarted && "Can't call beginSecondaryCommandBuffer if frame is not in progress");
+    assert(slot < recordingSlotCount && "Recording slot out of range");
+
+    VkCommandBuffer commandBuffer = frameContexts[currentFrameIndex]->allocateSecondary(slot);
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = swapchain->getRenderPass();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = swapchain->getFrameBuffer(currentImageIndex);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+    setViewportAndScissor(commandBuffer);
+    return commandBuffer;
+}
+
+void Renderer::executeSecondaryCommandBuffers(VkCommandBuffer commandBuffer,
+                                              const std::vector<VkCommandBuffer> &secondaryCommandBuffers)
+{
+    assert(commandBuffer == getCurrentCommandBuffer() &&
+           "Can't execute secondary command buffers on command buffer from a different frame");
+    if (secondaryCommandBuffers.empty())
+    {
+        return;
+    }
+
+    for (VkCommandBuffer secondaryCommandBuffer : secondaryCommandBuffers)
+    {
+        if (vkEndCommandBuffer(secondaryCommandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+    }
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                         secondaryCommandBuffers.data());
+}
+
 } // namespace fte
@@ -0,0 +1,103 @@
+#include "sampler_cache.hpp"
+
+#include "device.hpp"
+#include "utils.hpp"
+
+#include <stdexcept>
+
+namespace fte {
+bool SamplerCache::Key::operator==(const Key& other) const
+{
+    return flags == other.flags
+        && magFilter == other.magFilter
+        && minFilter == other.minFilter
+        && mipmapMode == other.mipmapMode
+        && addressModeU == other.addressModeU
+        && addressModeV == other.addressModeV
+        && addressModeW == other.addressModeW
+        && mipLodBias == other.mipLodBias
+        && anisotropyEnable == other.anisotropyEnable
+        && maxAnisotropy == other.maxAnisotropy
+        && compareEnable == other.compareEnable
+        && compareOp == other.compareOp
+        && minLod == other.minLod
+        && maxLod == other.maxLod
+        && borderColor == other.borderColor
+        && unnormalizedCoordinates == other.unnormalizedCoordinates;
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+    size_t seed = 0;
+    hashCombine(seed, key.flags, key.magFilter, key.minFilter, key.mipmapMode,
+        key.addressModeU, key.addressModeV, key.addressModeW, key.mipLodBias,
+        key.anisotropyEnable, key.maxAnisotropy, key.compareEnable, key.compareOp,
+        key.minLod, key.maxLod, key.borderColor, key.unnormalizedCoordinates);
+    return seed;
+}
+
+SamplerCache::SamplerCache(Device& device)
+    : treDevice { device }
+{
+}
+
+SamplerCache::Handle SamplerCache::get(const VkSamplerCreateInfo& createInfo)
+{
+    if (createInfo.pNext != nullptr) {
+        throw std::runtime_error("sampler cache does not support pNext chains!");
+    }
+
+    Key key {
+        createInfo.flags,
+        createInfo.magFilter,
+        createInfo.minFilter,
+        createInfo.mipmapMode,
+        createInfo.addressModeU,
+        createInfo.addressModeV,
+        createInfo.addressModeW,
+        createInfo.mipLodBias,
+        createInfo.anisotropyEnable,
+        createInfo.maxAnisotropy,
+        createInfo.compareEnable,
+        createInfo.compareOp,
+        createInfo.minLod,
+        createInfo.maxLod,
+        createInfo.borderColor,
+        createInfo.unnormalizedCoordinates,
+    };
+
+    auto it = samplers.find(key);
+    if (it != samplers.end()) {
+        if (Handle sampler = it->second.lock()) {
+            return sampler;
+        }
+    }
+
+    VkSampler sampler;
+    if (vkCreateSampler(treDevice.getLogicalDevice(), &createInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create sampler!");
+    }
+
+    VkDevice logicalDevice = treDevice.getLogicalDevice();
+    Handle handle { new VkSampler { sampler }, [logicalDevice](const VkSampler* sampler) {
+                       vkDestroySampler(logicalDevice, *sampler, nullptr);
+                       delete sampler;
+                   } };
+
+    // Drop entries whose samplers are gone before adding another.
+    for (auto entry = samplers.begin(); entry != samplers.end();) {
+        entry = entry->second.expired() ? samplers.erase(entry) : std::next(entry);
+    }
+    samplers[key] = handle;
+    return handle;
+}
+
+size_t SamplerCache::getSamplerCount() const
+{
+    size_t count = 0;
+    for (const auto& [key, sampler] : samplers) {
+        count += sampler.expired() ? 0 : 1;
+    }
+    return count;
+}
+} // namespace fte
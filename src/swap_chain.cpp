@@ -39,6 +39,12 @@ void Swapchain::init()
     }
 
     createRenderPass();
+    // The renderer waits for the device to go idle before recreating the swapchain, so the
+    // old attachments can go first and the new ones reuse their transient memory.
+    if (oldSwapchain != nullptr)
+    {
+        oldSwapchain->destroyAttachments();
+    }
     createDepthResources();
     createColorResources();
     createFramebuffers();
@@ -65,19 +71,7 @@ Swapchain::~Swapchain()
         swapchain = nullptr;
     }
 
-    for (int i = 0; i < depthImages.size(); i++)
-    {
-        vkDestroyImageView(device.getLogicalDevice(), depthImageViews[i], nullptr);
-        vkDestroyImage(device.getLogicalDevice(), depthImages[i], nullptr);
-        vkFreeMemory(device.getLogicalDevice(), depthImageMemorys[i], nullptr);
-    }
-
-    for (int i = 0; i < colorImages.size(); i++)
-    {
-        vkDestroyImageView(device.getLogicalDevice(), colorImageViews[i], nullptr);
-        vkDestroyImage(device.getLogicalDevice(), colorImages[i], nullptr);
-        vkFreeMemory(device.getLogicalDevice(), colorImageMemorys[i], nullptr);
-    }
+    destroyAttachments();
 
     vkDestroyRenderPass(device.getLogicalDevice(), renderPass, nullptr);
 
@@ -85,14 +79,12 @@ Swapchain::~Swapchain()
     {
         vkDestroySemaphore(device.getLogicalDevice(), renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device.getLogicalDevice(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.getLogicalDevice(), inFlightFences[i], nullptr);
     }
 }
 
 VkResult Swapchain::acquireNextImage(uint32_t* imageIndex)
 {
-    vkWaitForFences(
-        device.getLogicalDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    device.getGraphicsTimeline().wait(frameValues[currentFrame]);
 
     VkResult result = vkAcquireNextImageKHR(device.getLogicalDevice(),
                                             swapchain,
@@ -106,11 +98,8 @@ VkResult Swapchain::acquireNextImage(uint32_t* imageIndex)
 
 VkResult Swapchain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex)
 {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE)
-    {
-        vkWaitForFences(device.getLogicalDevice(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-    }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+    Timeline& timeline = device.getGraphicsTimeline();
+    timeline.wait(imageValues[*imageIndex]);
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -128,11 +117,9 @@ VkResult Swapchain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.getLogicalDevice(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to submit draw command buffer!");
-    }
+    Timeline::Value value = timeline.submit(device.getGraphicsQueue(), submitInfo);
+    frameValues[currentFrame] = value;
+    imageValues[*imageIndex] = value;
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -246,7 +233,8 @@ void Swapchain::createRenderPass()
     colorAttachment.format = swapchainImageFormat;
     colorAttachment.samples = device.getMaxUsableSampleCount();
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    // Only the resolved image is kept, so the samples never have to leave tile memory.
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -291,15 +279,18 @@ void Swapchain::createRenderPass()
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
     subpass.pResolveAttachments = &colorAttachmentResolveRef;
 
+    // Frames in flight share the multisampled attachments, so this frame's clears wait for
+    // the previous frame's attachment writes as well as for the acquired swapchain image.
     VkSubpassDependency dependency {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask
-        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask
-        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                              | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                              | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                               | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
     std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
     VkRenderPassCreateInfo renderPassInfo {};
@@ -322,12 +313,12 @@ void Swapchain::createFramebuffers()
     swapchainFramebuffers.resize(imageCount());
     for (size_t i = 0; i < imageCount(); i++)
     {
-        if (!colorImageViews[i] || !depthImageViews[i] || !swapchainImageViews[i])
+        if (!colorImageView || !depthImageView || !swapchainImageViews[i])
         {
             throw std::runtime_error("Framebuffer attachments not initialized!");
         }
 
-        std::array<VkImageView, 3> attachments = {colorImageViews[i], depthImageViews[i], swapchainImageViews[i]};
+        std::array<VkImageView, 3> attachments = {colorImageView, depthImageView, swapchainImageViews[i]};
 
         VkFramebufferCreateInfo framebufferInfo {};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -352,48 +343,61 @@ void Swapchain::createDepthResources()
     swapchainDepthFormat = depthFormat;
     VkExtent2D swapchainExtent = getSwapchainExtent();
 
-    depthImages.resize(imageCount());
-    depthImageMemorys.resize(imageCount());
-    depthImageViews.resize(imageCount());
-
-    for (int i = 0; i < depthImages.size(); i++)
-    {
-        device.createImage(swapchainExtent.width,
-                           swapchainExtent.height,
-                           1,
-                           device.getMaxUsableSampleCount(),
-                           depthFormat,
-                           VK_IMAGE_TILING_OPTIMAL,
-                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                           depthImages[i],
-                           depthImageMemorys[i]);
-
-        depthImageViews[i] = createImageView(depthImages[i], depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-    }
+    // Cleared on load and never stored, so tilers can keep it on chip without backing memory.
+    device.createImage(swapchainExtent.width,
+                       swapchainExtent.height,
+                       1,
+                       device.getMaxUsableSampleCount(),
+                       depthFormat,
+                       VK_IMAGE_TILING_OPTIMAL,
+                       VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                       depthImage,
+                       depthImageAllocation,
+                       nullptr,
+                       MemoryAllocator::Pool::Transient);
+
+    depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
 void Swapchain::createColorResources()
 {
     VkFormat colorFormat = swapchainImageFormat;
 
-    colorImages.resize(imageCount());
-    colorImageMemorys.resize(imageCount());
-    colorImageViews.resize(imageCount());
+    device.createImage(swapchainExtent.width,
+                       swapchainExtent.height,
+                       1,
+                       device.getMaxUsableSampleCount(),
+                       colorFormat,
+                       VK_IMAGE_TILING_OPTIMAL,
+                       VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                       colorImage,
+                       colorImageAllocation,
+                       nullptr,
+                       MemoryAllocator::Pool::Transient);
+    colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+}
+
+void Swapchain::destroyAttachments()
+{
+    // Safe to call twice: a swapchain that has been replaced already gave its attachments up.
+    if (depthImage != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(device.getLogicalDevice(), depthImageView, nullptr);
+        vkDestroyImage(device.getLogicalDevice(), depthImage, nullptr);
+        device.getMemoryAllocator().free(depthImageAllocation);
+        depthImage = VK_NULL_HANDLE;
+        depthImageView = VK_NULL_HANDLE;
+    }
 
-    for (int i = 0; i < colorImages.size(); i++)
+    if (colorImage != VK_NULL_HANDLE)
     {
-        device.createImage(swapchainExtent.width,
-                           swapchainExtent.height,
-                           1,
-                           device.getMaxUsableSampleCount(),
-                           colorFormat,
-                           VK_IMAGE_TILING_OPTIMAL,
-                           VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                           colorImages[i],
-                           colorImageMemorys[i]);
-        colorImageViews[i] = createImageView(colorImages[i], colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+        vkDestroyImageView(device.getLogicalDevice(), colorImageView, nullptr);
+        vkDestroyImage(device.getLogicalDevice(), colorImage, nullptr);
+        device.getMemoryAllocator().free(colorImageAllocation);
+        colorImage = VK_NULL_HANDLE;
+        colorImageView = VK_NULL_HANDLE;
     }
 }
 
@@ -401,23 +405,18 @@ void Swapchain::createSyncObjects()
 {
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+    frameValues.resize(MAX_FRAMES_IN_FLIGHT, 0);
+    imageValues.resize(imageCount(), 0);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
         if (vkCreateSemaphore(device.getLogicalDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i])
                 != VK_SUCCESS
             || vkCreateSemaphore(device.getLogicalDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i])
-                != VK_SUCCESS
-            || vkCreateFence(device.getLogicalDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+                != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
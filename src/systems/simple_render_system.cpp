@@ -1,23 +1,35 @@
 #include "systems/simple_render_system.hpp"
 
+#include "thread_pool.hpp"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
+#include <tuple>
 
 namespace fte {
+// 116 bytes, within the 128 every device guarantees. The normal matrix is a mat3 laid
+// out as three vec4 columns (std430), which leaves room for the texture index.
 struct SimplePushConstantData {
     glm::mat4 modelMatrix { 1.f };
-    glm::mat4 normalMatrix { 1.f };
+    glm::vec4 normalMatrix[3] {};
+    uint32_t textureIndex = 0;
 };
 
-SimpleRenderSystem::SimpleRenderSystem(
-    Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+// Largest LOD error allowed on screen, in NDC units (about one pixel at 1080p).
+constexpr float MAX_LOD_SCREEN_ERROR = 2.0f / 1080.0f;
+
+SimpleRenderSystem::SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+    BindlessTextures& bindlessTextures)
     : treDevice { device }
+    , bindlessTextures { bindlessTextures }
 {
     createPipelineLayout(globalSetLayout);
     createPipeline(renderPass);
@@ -35,7 +47,7 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLay
     pushConstantRange.offset = 0;
     pushConstantRange.size = sizeof(SimplePushConstantData);
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts { globalSetLayout };
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts { globalSetLayout, bindlessTextures.getSetLayout() };
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -61,39 +73,232 @@ void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
         "assets/shaders/bin/simple_shader.vert.spv",
         "assets/shaders/bin/simple_shader.frag.spv",
         pipelineConfig);
+
+    PipelineConfigInfo packedPipelineConfig {};
+    Pipeline::defaultPipelineConfigInfo(packedPipelineConfig, treDevice.getMaxUsableSampleCount());
+    packedPipelineConfig.bindingDescriptions = Model::PackedVertex::getBindingDescriptions();
+    packedPipelineConfig.attributeDescriptions = Model::PackedVertex::getAttributeDescriptions();
+    packedPipelineConfig.renderPass = renderPass;
+    packedPipelineConfig.pipelineLayout = pipelineLayout;
+    packedPipeline = std::make_unique<Pipeline>(
+        treDevice,
+        "assets/shaders/bin/simple_shader_packed.vert.spv",
+        "assets/shaders/bin/simple_shader.frag.spv",
+        packedPipelineConfig);
+}
+
+void SimpleRenderSystem::cullMeshlets(const Model& model, const glm::mat4& modelMatrix,
+    const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+{
+    // Frustum planes and camera in model space, so meshlet bounds are used as stored.
+    glm::mat4 clip = viewProjection * modelMatrix;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = { clip[0][i], clip[1][i], clip[2][i], clip[3][i] };
+    }
+    std::array<glm::vec4, 6> planes {
+        rows[3] + rows[0],
+        rows[3] - rows[0],
+        rows[3] + rows[1],
+        rows[3] - rows[1],
+        rows[2], // depth is [0, 1]
+        rows[3] - rows[2],
+    };
+    for (auto& plane : planes) {
+        plane /= glm::length(glm::vec3 { plane });
+    }
+    glm::vec3 eye = glm::vec3 { glm::inverse(modelMatrix) * glm::vec4 { cameraPosition, 1.0f } };
+
+    for (const auto& meshlet : model.getMeshlets()) {
+        glm::vec3 center { meshlet.center[0], meshlet.center[1], meshlet.center[2] };
+
+        bool visible = true;
+        for (const auto& plane : planes) {
+            if (glm::dot(glm::vec3 { plane }, center) + plane.w < -meshlet.radius) {
+                visible = false;
+                break;
+            }
+        }
+        if (!visible)
+            continue;
+
+        if (meshletConeCulling && meshlet.coneCutoff < 1.0f) {
+            glm::vec3 axis { meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2] };
+            glm::vec3 toCenter = center - eye;
+            if (glm::dot(toCenter, axis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+                continue;
+        }
+
+        // Meshlets are stored back to back, so neighbours that both survive share a draw.
+        uint32_t firstIndex = model.getFirstIndex() + meshlet.firstIndex;
+        auto& objectDraw = objectDraws.back();
+        if (drawCommands.size() > objectDraw.firstCommand) {
+            auto& last = drawCommands.back();
+            if (last.firstIndex + last.indexCount == firstIndex) {
+                last.indexCount += meshlet.indexCount;
+                continue;
+            }
+        }
+        drawCommands.push_back({ meshlet.indexCount, 1, firstIndex, model.getVertexOffset(), 0 });
+        objectDraw.commandCount++;
+    }
+}
+
+uint32_t SimpleRenderSystem::selectLod(const Model& model, const glm::mat4& modelMatrix,
+    const glm::mat4& projection, const glm::vec3& cameraPosition) const
+{
+    const auto& lods = model.getLods();
+    if (lods.size() <= 1)
+        return 0;
+
+    float scale = std::max({ glm::length(glm::vec3 { modelMatrix[0] }),
+        glm::length(glm::vec3 { modelMatrix[1] }),
+        glm::length(glm::vec3 { modelMatrix[2] }) });
+    float radius = model.getBoundingRadius() * scale;
+    glm::vec3 center = glm::vec3 { modelMatrix * glm::vec4 { model.getBoundingCenter(), 1.0f } };
+
+    // Projected radius of the bounding sphere; |proj[1][1]| is cot(fovy / 2) for a
+    // perspective camera (negated by Camera to flip y) and the full scale for an
+    // orthographic one.
+    float projectedRadius = radius * std::abs(projection[1][1]);
+    if (projection[2][3] != 0.0f) {
+        float distance = glm::length(center - cameraPosition) - radius;
+        if (distance <= 0.0f)
+            return 0;
+        projectedRadius /= distance;
+    }
+
+    for (uint32_t lod = static_cast<uint32_t>(lods.size()) - 1; lod > 0; lod--) {
+        if (lods[lod].error * projectedRadius <= MAX_LOD_SCREEN_ERROR)
+            return lod;
+    }
+    return 0;
+}
+
+void SimpleRenderSystem::prepareGameObjects(FrameInfo& frameInfo)
+{
+    // Cull every object's meshlets first so the frame's indirect commands are written in
+    // one piece before any draw refers to them.
+    glm::mat4 viewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+    glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+
+    drawCommands.clear();
+    objectDraws.clear();
+    for (auto& kv : frameInfo.gameObjects) {
+        auto& obj = kv.second;
+        if (obj.model == nullptr)
+            continue;
+
+        glm::mat4 modelMatrix = obj.transform.mat4();
+        uint32_t lod = selectLod(*obj.model, modelMatrix, frameInfo.camera.getProjection(), cameraPosition);
+
+        Pipeline* pipeline = obj.model->getVertexFormat() == Model::VertexFormat::Packed ? packedPipeline.get() : trePipeline.get();
+
+        // Meshlets only cover LOD 0; coarser levels are small enough to draw whole.
+        // Texture slots are resolved here since BindlessTextures is not thread-safe.
+        uint32_t textureIndex = bindlessTextures.getIndex(obj.texture.share());
+        objectDraws.push_back({ &obj, pipeline, static_cast<uint32_t>(drawCommands.size()), 0, lod, textureIndex });
+        if (lod == 0 && !obj.model->getMeshlets().empty())
+            cullMeshlets(*obj.model, modelMatrix, viewProjection, cameraPosition);
+    }
+
+    indirectCommands = {};
+    if (!drawCommands.empty()) {
+        indirectCommands = frameInfo.frameAllocator.push(
+            drawCommands.data(), drawCommands.size() * sizeof(VkDrawIndexedIndirectCommand), 4);
+    }
+
+    // Group draws by pipeline and geometry pool page so most of them need no rebinding.
+    std::sort(objectDraws.begin(), objectDraws.end(), [](const ObjectDraw& a, const ObjectDraw& b) {
+        const Model& modelA = *a.object->model;
+        const Model& modelB = *b.object->model;
+        return std::make_tuple(a.pipeline, modelA.getVertexBuffer(), modelA.getIndexBuffer(), modelA.getIndexType())
+            < std::make_tuple(b.pipeline, modelB.getVertexBuffer(), modelB.getIndexBuffer(), modelB.getIndexType());
+    });
 }
 
 void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo)
 {
-    trePipeline->bind(frameInfo.commandBuffer);
+    recordDraws(frameInfo.commandBuffer, frameInfo, 0, objectDraws.size());
+}
+
+std::vector<VkCommandBuffer> SimpleRenderSystem::recordGameObjects(FrameInfo& frameInfo, Renderer& renderer)
+{
+    size_t recordingCount = std::min<size_t>(renderer.getRecordingSlotCount(),
+        std::max<size_t>(1, objectDraws.size() / MIN_DRAWS_PER_RECORDING));
+    std::vector<VkCommandBuffer> commandBuffers(recordingCount);
 
+    // Each run keeps the sort order, so state changes only grow by one rebind per run.
+    ThreadPool::shared().parallelFor(static_cast<uint32_t>(recordingCount), [&](uint32_t slot) {
+        size_t firstDraw = objectDraws.size() * slot / recordingCount;
+        size_t lastDraw = objectDraws.size() * (slot + 1) / recordingCount;
+        commandBuffers[slot] = renderer.beginSecondaryCommandBuffer(slot);
+        recordDraws(commandBuffers[slot], frameInfo, firstDraw, lastDraw);
+    });
+    return commandBuffers;
+}
+
+void SimpleRenderSystem::recordDraws(
+    VkCommandBuffer commandBuffer, const FrameInfo& frameInfo, size_t firstDraw, size_t lastDraw)
+{
+    // Bound once; every draw below only changes its texture index.
+    static_assert(BindlessTextures::SET_INDEX == 1, "bindless textures follow the global set");
+    VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, bindlessTextures.getDescriptorSet() };
     vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
+        commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout,
         0,
+        2,
+        descriptorSets,
         1,
-        &frameInfo.globalDescriptorSet,
-        0,
-        nullptr);
+        &frameInfo.globalUboOffset);
 
-    for (auto& kv : frameInfo.gameObjects) {
-        auto& obj = kv.second;
-        if (obj.model == nullptr)
+    Pipeline* boundPipeline = nullptr;
+    const Model* boundModel = nullptr;
+    for (size_t drawIndex = firstDraw; drawIndex < lastDraw; drawIndex++) {
+        const auto& objectDraw = objectDraws[drawIndex];
+        auto& obj = *objectDraw.object;
+        bool hasMeshlets = objectDraw.lod == 0 && !obj.model->getMeshlets().empty();
+        if (hasMeshlets && objectDraw.commandCount == 0)
             continue;
+
+        if (objectDraw.pipeline != boundPipeline) {
+            objectDraw.pipeline->bind(commandBuffer);
+            boundPipeline = objectDraw.pipeline;
+        }
+
         SimplePushConstantData push {};
-        push.modelMatrix = obj.transform.mat4();
-        push.normalMatrix = obj.transform.normalMatrix();
+        push.modelMatrix = obj.transform.mat4() * obj.model->getPositionDequantization();
+        glm::mat3 normalMatrix = obj.transform.normalMatrix();
+        for (int i = 0; i < 3; i++) {
+            push.normalMatrix[i] = glm::vec4 { normalMatrix[i], 0.0f };
+        }
+        push.textureIndex = objectDraw.textureIndex;
 
         vkCmdPushConstants(
-            frameInfo.commandBuffer,
+            commandBuffer,
             pipelineLayout,
             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
             0,
             sizeof(SimplePushConstantData),
             &push);
-        obj.model->bind(frameInfo.commandBuffer);
-        obj.model->draw(frameInfo.commandBuffer);
+        if (boundModel == nullptr
+            || boundModel->getVertexBuffer() != obj.model->getVertexBuffer()
+            || boundModel->getIndexBuffer() != obj.model->getIndexBuffer()
+            || boundModel->getIndexType() != obj.model->getIndexType()) {
+            obj.model->bind(commandBuffer);
+            boundModel = obj.model.get();
+        }
+        if (hasMeshlets) {
+            obj.model->drawIndirect(
+                commandBuffer,
+                indirectCommands.buffer,
+                indirectCommands.offset + objectDraw.firstCommand * sizeof(VkDrawIndexedIndirectCommand),
+                objectDraw.commandCount);
+        } else {
+            obj.model->draw(commandBuffer, objectDraw.lod);
+        }
     }
 }
 } // namespace tre
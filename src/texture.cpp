@@ -1,42 +1,164 @@
 #include "texture.hpp"
-#include "buffer.hpp"
+#include "block_compressor.hpp"
+#include "asset_file_system.hpp"
+#include "ktx2.hpp"
+#include "texture_cache.hpp"
+#include "upload_manager.hpp"
+#include "utils.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include <stdexcept>
 #include <cmath> 
+#include <cstring>
 #include <algorithm> 
+#include <cctype>
+#include <cstdio>
+#include <iostream>
 
 namespace fte {
 
-	Texture::Texture(Device& device, const std::string& filePath) : device(device) {
-		int channels;
-		stbi_uc* data = stbi_load(filePath.c_str(), &width, &height, &channels, 4);
-		if (!data) {
-			throw std::runtime_error("Failed to open file: " + filePath);
+	namespace {
+		constexpr const char* SOURCE_HASH_KEY = "fteSourceHash";
+
+		Texture::ImageData decodeImage(const AssetFile& source, const std::string& filePath, uint64_t sourceHash) {
+			Texture::ImageData image{};
+			int channels;
+			stbi_uc* data = source.isOpen()
+				? stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &image.width, &image.height, &channels, 4)
+				: nullptr;
+			if (!data) {
+				throw std::runtime_error("Failed to open file: " + filePath);
+			}
+
+			image.pixels.assign(data, data + static_cast<size_t>(image.width) * image.height * 4);
+			image.sourceHash = sourceHash;
+			stbi_image_free(data);
+			return image;
 		}
 
-		mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1);
+		std::string toHex(uint64_t value) {
+			char text[17];
+			std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+			return text;
+		}
+	}
 
-		Buffer stagingBuffer(device, 4,
-			static_cast<uint32_t>(width * height),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	Texture::ImageData Texture::loadImageData(const std::string& filePath, Compression compression) {
+		std::string extension = filePath.size() >= 5 ? filePath.substr(filePath.size() - 5) : std::string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer(data);
+		AssetFile source{};
+		source.open(filePath);
+		const uint64_t sourceHash = source.isOpen() ? hashBytes(source.data(), source.size()) : 0;
 
-		imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+		if (extension == ".ktx2") {
+			ImageData image = Ktx2::read(filePath);
+			image.sourceHash = sourceHash;
+			return image;
+		}
+		if (compression == Compression::None) {
+			return decodeImage(source, filePath, sourceHash);
+		}
 
+		const std::string cachePath = filePath + (compression == Compression::BC1 ? ".bc1.ktx2" : ".bc7.ktx2");
+
+		// A cache without its source next to it is trusted as shipped; a stale or broken one is rebuilt.
+		if (AssetFileSystem::shared().exists(cachePath)) {
+			try {
+				Ktx2::KeyValues keyValues;
+				ImageData cached = Ktx2::read(cachePath, &keyValues);
+				if (!source.isOpen() || keyValues[SOURCE_HASH_KEY] == toHex(sourceHash)) {
+					cached.sourceHash = sourceHash;
+					return cached;
+				}
+			}
+			catch (const std::exception& e) {
+				std::cerr << "ignoring texture cache " << cachePath << ": " << e.what() << std::endl;
+			}
+		}
 
-		device.createImage(width, height, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+		ImageData compressed = BlockCompressor::compress(decodeImage(source, filePath, sourceHash),
+			compression == Compression::BC1 ? BlockCompressor::Format::BC1 : BlockCompressor::Format::BC7);
 
-		transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		Ktx2::write(cachePath, compressed, { { "KTXwriter", "FastTinyEngine" }, { SOURCE_HASH_KEY, toHex(sourceHash) } });
+		compressed.sourceHash = sourceHash;
+		return compressed;
+	}
+
+	Texture::Texture(Device& device, const std::string& filePath) : Texture(device, loadImageData(filePath)) {}
+
+	Texture::Texture(Device& device, const ImageData& imageData) : device(device) {
+		width = imageData.width;
+		height = imageData.height;
+		imageFormat = imageData.format;
+		const uint8_t* data = imageData.pixels.data();
+
+		bool precomputedMips = !imageData.levels.empty();
+		if (precomputedMips) {
+			// Throws for formats the GPU can't sample, e.g. BC without textureCompressionBC.
+			device.findSupportedFormat({ imageFormat }, VK_IMAGE_TILING_OPTIMAL,
+				VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+			mipLevels = static_cast<int>(imageData.levels.size());
+		}
+		else {
+			mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1);
+		}
 
-		device.copyBufferToImage(stagingBuffer.getBuffer(), image, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
+		UploadManager& uploads = device.getUploadManager();
+		VkDeviceSize imageSize = precomputedMips ? imageData.pixels.size() : static_cast<VkDeviceSize>(width) * height * 4;
+		UploadManager::StagingAllocation staging = uploads.allocateStaging(imageSize);
+		std::memcpy(staging.mapped, data, imageSize);
 
-		generateMipmaps();
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		if (!precomputedMips) {
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+		device.createImage(width, height, mipLevels, VK_SAMPLE_COUNT_1_BIT, imageFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+		// Recorded into the upload batch; nothing here waits for the GPU.
+		VkCommandBuffer commandBuffer = uploads.getCommandBuffer();
+
+		transitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		// Hands the image to the graphics queue when uploads run on a dedicated transfer queue.
+		VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, static_cast<uint32_t>(mipLevels), 0, 1 };
+
+		if (precomputedMips) {
+			// Every level in one copy; block-compressed data can't be blitted anyway.
+			std::vector<VkBufferImageCopy> regions(imageData.levels.size());
+			for (size_t level = 0; level < regions.size(); level++) {
+				const MipLevel& mip = imageData.levels[level];
+				regions[level].bufferOffset = staging.offset + mip.offset;
+				regions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				regions[level].imageSubresource.mipLevel = static_cast<uint32_t>(level);
+				regions[level].imageSubresource.baseArrayLayer = 0;
+				regions[level].imageSubresource.layerCount = 1;
+				regions[level].imageExtent = { mip.width, mip.height, 1 };
+			}
+			vkCmdCopyBufferToImage(commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				static_cast<uint32_t>(regions.size()), regions.data());
+
+			uploads.transferImageToGraphics(image, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		}
+		else {
+			VkBufferImageCopy region{};
+			region.bufferOffset = staging.offset;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 };
+			vkCmdCopyBufferToImage(commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+			// Blits need a graphics-capable queue.
+			uploads.transferImageToGraphics(image, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+			generateMipmaps(uploads.getGraphicsCommandBuffer());
+		}
+		uploadToken = uploads.getCurrentToken();
 
 		imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
@@ -51,7 +173,9 @@ namespace fte {
 		samplerInfo.mipLodBias = 0.0f;
 		samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
 		samplerInfo.minLod = 0.0f;
-		samplerInfo.maxLod = static_cast<float>(mipLevels);
+		// The image view already limits the levels; an open-ended maxLod lets every texture
+		// share one sampler.
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 		samplerInfo.unnormalizedCoordinates = VK_FALSE;
 
@@ -62,9 +186,7 @@ namespace fte {
 		samplerInfo.maxAnisotropy = std::min(properties.limits.maxSamplerAnisotropy, 16.0f);
 
 
-		if (vkCreateSampler(device.getLogicalDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create sampler!");
-		}
+		sampler = device.getSamplerCache().get(samplerInfo);
 
 		VkImageViewCreateInfo imageViewInfo{};
 		imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -86,25 +208,22 @@ namespace fte {
 		if (vkCreateImageView(device.getLogicalDevice(), &imageViewInfo, nullptr, &imageView) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create image view!");
 		}
-
-		stbi_image_free(data);
 	}
 
 	Texture::~Texture() {
-		vkDeviceWaitIdle(device.getLogicalDevice());
-		vkDestroyImage(device.getLogicalDevice(), image, nullptr);
-		vkFreeMemory(device.getLogicalDevice(), imageMemory, nullptr);
-		vkDestroyImageView(device.getLogicalDevice(), imageView, nullptr);
-		vkDestroySampler(device.getLogicalDevice(), sampler, nullptr);
+		// Frames and uploads already submitted may still use the image.
+		device.deferDestroy([&device = device, image = image, imageView = imageView, allocation = imageAllocation]() mutable {
+			vkDestroyImageView(device.getLogicalDevice(), imageView, nullptr);
+			vkDestroyImage(device.getLogicalDevice(), image, nullptr);
+			device.getMemoryAllocator().free(allocation);
+		});
 	}
 
 	std::shared_ptr<Texture> Texture::createTextureFromFile(Device& device, const std::string& filePath) {
-		return std::make_shared<Texture>(device, filePath);
+		return device.getTextureCache().load(filePath);
 	}
 
-	void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout) {
-		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
+	void Texture::transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
 		VkImageMemoryBarrier barrier{};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		barrier.oldLayout = oldLayout;
@@ -142,11 +261,9 @@ namespace fte {
 
 		vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0,
 			0, nullptr, 0, nullptr, 1, &barrier);
-
-		device.endSingleTimeCommands(commandBuffer);
 	}
 
-	void Texture::generateMipmaps() {
+	void Texture::generateMipmaps(VkCommandBuffer commandBuffer) {
 		VkFormatProperties formatProperties{};
 		vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), imageFormat, &formatProperties);
 
@@ -154,8 +271,6 @@ namespace fte {
 			throw std::runtime_error("Texture image format does not support linear blitting!");
 		}
 
-		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
 		VkImageMemoryBarrier barrier{};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		barrier.image = image;
@@ -222,7 +337,5 @@ namespace fte {
 
 		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
 			0, nullptr, 0, nullptr, 1, &barrier);
-
-		device.endSingleTimeCommands(commandBuffer);
 	}
 } // namespace tre
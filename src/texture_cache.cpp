@@ -0,0 +1,90 @@
+#include "texture_cache.hpp"
+
+#include <filesystem>
+#include <unordered_set>
+
+namespace fte {
+TextureCache::TextureCache(Device& device)
+    : treDevice { device }
+{
+}
+
+std::string TextureCache::makeKey(const std::string& filePath, Texture::Compression compression)
+{
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::weakly_canonical(filePath, error);
+    if (error) {
+        path = std::filesystem::absolute(filePath, error).lexically_normal();
+    }
+
+    std::string key = path.generic_string();
+    if (compression == Texture::Compression::BC1) {
+        key += "#bc1";
+    } else if (compression == Texture::Compression::BC7) {
+        key += "#bc7";
+    }
+    return key;
+}
+
+std::shared_ptr<Texture> TextureCache::find(const std::string& key)
+{
+    auto it = texturesByPath.find(key);
+    return it != texturesByPath.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<Texture> TextureCache::create(const std::string& key, const Texture::ImageData& image)
+{
+    if (auto texture = find(key)) {
+        return texture;
+    }
+
+    removeExpired();
+
+    std::shared_ptr<Texture> texture;
+    if (image.sourceHash != 0) {
+        auto it = texturesByContent.find({ image.sourceHash, image.format });
+        if (it != texturesByContent.end()) {
+            texture = it->second.lock();
+        }
+    }
+    if (!texture) {
+        texture = std::make_shared<Texture>(treDevice, image);
+        if (image.sourceHash != 0) {
+            texturesByContent[{ image.sourceHash, image.format }] = texture;
+        }
+    }
+
+    texturesByPath[key] = texture;
+    return texture;
+}
+
+std::shared_ptr<Texture> TextureCache::load(const std::string& filePath, Texture::Compression compression)
+{
+    std::string key = makeKey(filePath, compression);
+    if (auto texture = find(key)) {
+        return texture;
+    }
+    return create(key, Texture::loadImageData(filePath, compression));
+}
+
+size_t TextureCache::getTextureCount() const
+{
+    std::unordered_set<const Texture*> textures;
+    for (const auto& [key, texture] : texturesByPath) {
+        if (auto live = texture.lock()) {
+            textures.insert(live.get());
+        }
+    }
+    return textures.size();
+}
+
+void TextureCache::removeExpired()
+{
+    for (auto it = texturesByPath.begin(); it != texturesByPath.end();) {
+        it = it->second.expired() ? texturesByPath.erase(it) : std::next(it);
+    }
+    for (auto it = texturesByContent.begin(); it != texturesByContent.end();) {
+        it = it->second.expired() ? texturesByContent.erase(it) : std::next(it);
+    }
+}
+} // namespace fte
@@ -0,0 +1,109 @@
+#include "timeline.hpp"
+
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace fte {
+Timeline::Timeline(VkDevice device)
+    : device { device }
+{
+    VkSemaphoreTypeCreateInfo typeInfo {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+Timeline::~Timeline()
+{
+    vkDestroySemaphore(device, semaphore, nullptr);
+}
+
+Timeline::Value Timeline::submit(VkQueue queue, const VkSubmitInfo& submitInfo, VkFence fence)
+{
+    return submit(queue, submitInfo, fence, nullptr);
+}
+
+Timeline::Value Timeline::submitAfter(VkQueue queue, VkCommandBuffer commandBuffer, const Timeline& waitTimeline,
+    Value waitValue, VkPipelineStageFlags waitStage)
+{
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &waitTimeline.semaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    return submit(queue, submitInfo, VK_NULL_HANDLE, &waitValue);
+}
+
+Timeline::Value Timeline::submit(VkQueue queue, const VkSubmitInfo& submitInfo, VkFence fence, const uint64_t* waitValues)
+{
+    Value value = lastSubmittedValue + 1;
+
+    // Values for binary semaphores are ignored, but the array must cover all of them.
+    std::vector<VkSemaphore> signalSemaphores(
+        submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    signalSemaphores.push_back(semaphore);
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+    signalValues.back() = value;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = submitInfo.pNext;
+    if (waitValues) {
+        timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues;
+    }
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo timelineSubmitInfo = submitInfo;
+    timelineSubmitInfo.pNext = &timelineInfo;
+    timelineSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    timelineSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    if (vkQueueSubmit(queue, 1, &timelineSubmitInfo, fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit command buffer!");
+    }
+    lastSubmittedValue = value;
+    return value;
+}
+
+Timeline::Value Timeline::getCompletedValue()
+{
+    if (vkGetSemaphoreCounterValue(device, semaphore, &completedValue) != VK_SUCCESS) {
+        throw std::runtime_error("failed to query timeline semaphore!");
+    }
+    return completedValue;
+}
+
+bool Timeline::isComplete(Value value)
+{
+    return value <= completedValue || value <= getCompletedValue();
+}
+
+void Timeline::wait(Value value)
+{
+    if (value <= completedValue) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+    if (vkWaitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait for timeline semaphore!");
+    }
+    completedValue = value;
+}
+} // namespace fte
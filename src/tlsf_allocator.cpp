@@ -0,0 +1,233 @@
+#include "tlsf_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace fte {
+namespace {
+    uint32_t highestBit(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+    }
+
+    uint32_t lowestBit(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t size)
+    : totalSize { size & ~(GRANULARITY - 1) }
+{
+    std::fill(&freeHeads[0][0], &freeHeads[0][0] + FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT, INVALID_NODE);
+    if (totalSize > 0) {
+        insertFree(createNode(0, totalSize));
+    }
+}
+
+void TlsfAllocator::mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    uint32_t bit = highestBit(size);
+    firstLevel = bit - SECOND_LEVEL_LOG2;
+    secondLevel = static_cast<uint32_t>(size >> (bit - SECOND_LEVEL_LOG2)) - SECOND_LEVEL_COUNT;
+}
+
+uint32_t TlsfAllocator::findFree(uint64_t size) const
+{
+    // Round up to the next size class so any block in it fits (good fit, not best fit).
+    uint64_t rounded = size + (uint64_t { 1 } << (highestBit(size) - SECOND_LEVEL_LOG2)) - 1;
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    mapping(rounded, firstLevel, secondLevel);
+    if (firstLevel < FIRST_LEVEL_COUNT) {
+        uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+        if (secondLevelMap == 0) {
+            uint64_t firstLevelMap = firstLevel + 1 < 64 ? firstLevelBitmap & (~uint64_t { 0 } << (firstLevel + 1)) : 0;
+            if (firstLevelMap != 0) {
+                firstLevel = lowestBit(firstLevelMap);
+                secondLevelMap = secondLevelBitmaps[firstLevel];
+            }
+        }
+        if (secondLevelMap != 0) {
+            return freeHeads[firstLevel][lowestBit(secondLevelMap)];
+        }
+    }
+
+    // Nothing in a larger class; a block in the request's own class may still be big
+    // enough (e.g. a whole empty heap block), so walk that one list.
+    mapping(size, firstLevel, secondLevel);
+    for (uint32_t index = freeHeads[firstLevel][secondLevel]; index != INVALID_NODE; index = nodes[index].nextFree) {
+        if (nodes[index].size >= size) {
+            return index;
+        }
+    }
+    return INVALID_NODE;
+}
+
+void TlsfAllocator::insertFree(uint32_t index)
+{
+    Node& node = nodes[index];
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    mapping(node.size, firstLevel, secondLevel);
+
+    uint32_t& head = freeHeads[firstLevel][secondLevel];
+    node.free = true;
+    node.previousFree = INVALID_NODE;
+    node.nextFree = head;
+    if (head != INVALID_NODE) {
+        nodes[head].previousFree = index;
+    }
+    head = index;
+    firstLevelBitmap |= uint64_t { 1 } << firstLevel;
+    secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::removeFree(uint32_t index)
+{
+    Node& node = nodes[index];
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    mapping(node.size, firstLevel, secondLevel);
+
+    if (node.previousFree != INVALID_NODE) {
+        nodes[node.previousFree].nextFree = node.nextFree;
+    } else {
+        freeHeads[firstLevel][secondLevel] = node.nextFree;
+    }
+    if (node.nextFree != INVALID_NODE) {
+        nodes[node.nextFree].previousFree = node.previousFree;
+    }
+    if (freeHeads[firstLevel][secondLevel] == INVALID_NODE) {
+        secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (secondLevelBitmaps[firstLevel] == 0) {
+            firstLevelBitmap &= ~(uint64_t { 1 } << firstLevel);
+        }
+    }
+    node.free = false;
+}
+
+uint32_t TlsfAllocator::createNode(uint64_t offset, uint64_t size)
+{
+    Node node { offset, size, INVALID_NODE, INVALID_NODE, INVALID_NODE, INVALID_NODE, false };
+    if (!unusedNodes.empty()) {
+        uint32_t index = unusedNodes.back();
+        unusedNodes.pop_back();
+        nodes[index] = node;
+        return index;
+    }
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void TlsfAllocator::releaseNode(uint32_t index)
+{
+    unusedNodes.push_back(index);
+}
+
+bool TlsfAllocator::allocate(uint64_t size, uint64_t alignment, Allocation& allocation)
+{
+    assert((alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+    size = alignUp(std::max<uint64_t>(size, 1), GRANULARITY);
+    alignment = std::max(alignment, GRANULARITY);
+    // Offsets are GRANULARITY-aligned already, so at most alignment - GRANULARITY of padding.
+    uint64_t searchSize = size + alignment - GRANULARITY;
+    if (searchSize > totalSize) {
+        return false;
+    }
+
+    uint32_t index = findFree(searchSize);
+    if (index == INVALID_NODE) {
+        return false;
+    }
+    removeFree(index);
+
+    // Leading padding becomes a free node of its own. Its physical predecessor is never
+    // free, since free neighbours are always merged.
+    uint64_t padding = alignUp(nodes[index].offset, alignment) - nodes[index].offset;
+    if (padding > 0) {
+        uint32_t front = createNode(nodes[index].offset, padding);
+        nodes[front].previousPhysical = nodes[index].previousPhysical;
+        nodes[front].nextPhysical = index;
+        if (nodes[index].previousPhysical != INVALID_NODE) {
+            nodes[nodes[index].previousPhysical].nextPhysical = front;
+        }
+        nodes[index].previousPhysical = front;
+        nodes[index].offset += padding;
+        nodes[index].size -= padding;
+        insertFree(front);
+    }
+
+    if (nodes[index].size - size >= GRANULARITY) {
+        uint32_t back = createNode(nodes[index].offset + size, nodes[index].size - size);
+        nodes[back].previousPhysical = index;
+        nodes[back].nextPhysical = nodes[index].nextPhysical;
+        if (nodes[index].nextPhysical != INVALID_NODE) {
+            nodes[nodes[index].nextPhysical].previousPhysical = back;
+        }
+        nodes[index].nextPhysical = back;
+        nodes[index].size = size;
+        insertFree(back);
+    }
+
+    usedSize += nodes[index].size;
+    allocation.offset = nodes[index].offset;
+    allocation.size = nodes[index].size;
+    allocation.node = index;
+    return true;
+}
+
+void TlsfAllocator::free(const Allocation& allocation)
+{
+    uint32_t index = allocation.node;
+    assert(index < nodes.size() && !nodes[index].free && "Invalid or double free");
+    usedSize -= nodes[index].size;
+
+    uint32_t next = nodes[index].nextPhysical;
+    if (next != INVALID_NODE && nodes[next].free) {
+        removeFree(next);
+        nodes[index].size += nodes[next].size;
+        nodes[index].nextPhysical = nodes[next].nextPhysical;
+        if (nodes[next].nextPhysical != INVALID_NODE) {
+            nodes[nodes[next].nextPhysical].previousPhysical = index;
+        }
+        releaseNode(next);
+    }
+
+    uint32_t previous = nodes[index].previousPhysical;
+    if (previous != INVALID_NODE && nodes[previous].free) {
+        removeFree(previous);
+        nodes[previous].size += nodes[index].size;
+        nodes[previous].nextPhysical = nodes[index].nextPhysical;
+        if (nodes[index].nextPhysical != INVALID_NODE) {
+            nodes[nodes[index].nextPhysical].previousPhysical = previous;
+        }
+        releaseNode(index);
+        index = previous;
+    }
+
+    insertFree(index);
+}
+} // namespace fte
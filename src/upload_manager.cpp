@@ -0,0 +1,332 @@
+#include "upload_manager.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace fte {
+namespace {
+    // Stage at which the graphics half of a batch waits for its transfer half. Acquire
+    // barriers use it as their source stage, so their layout transitions chain after the
+    // semaphore wait.
+    constexpr VkPipelineStageFlags TRANSFER_WAIT_STAGE = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+}
+
+UploadManager::UploadManager(Device& device, VkDeviceSize stagingSize)
+    : treDevice { device }
+{
+    QueueFamilies indices = treDevice.findQueueFamilies();
+    transferFamily = indices.transferFamily;
+    graphicsFamily = indices.graphicsFamily;
+    dedicatedTransfer = indices.hasDedicatedTransferFamily();
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = transferFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(treDevice.getLogicalDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+    if (dedicatedTransfer) {
+        poolInfo.queueFamilyIndex = graphicsFamily;
+        if (vkCreateCommandPool(treDevice.getLogicalDevice(), &poolInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload command pool!");
+        }
+    }
+
+    stagingRing = std::make_unique<Buffer>(
+        treDevice,
+        stagingSize,
+        1,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    stagingRing->map();
+}
+
+UploadManager::~UploadManager()
+{
+    flush();
+    while (!pendingBatches.empty()) {
+        retireOldest();
+    }
+
+    vkDestroyCommandPool(treDevice.getLogicalDevice(), commandPool, nullptr);
+    if (graphicsCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(treDevice.getLogicalDevice(), graphicsCommandPool, nullptr);
+    }
+}
+
+VkCommandBuffer UploadManager::allocateCommandBuffer(VkCommandPool pool)
+{
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(treDevice.getLogicalDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+    return commandBuffer;
+}
+
+void UploadManager::beginBatch()
+{
+    if (hasOpenBatch) {
+        return;
+    }
+
+    retireCompleted();
+
+    if (!freeBatches.empty()) {
+        openBatch = std::move(freeBatches.back());
+        freeBatches.pop_back();
+        vkResetCommandBuffer(openBatch.commandBuffer, 0);
+        if (dedicatedTransfer) {
+            vkResetCommandBuffer(openBatch.graphicsCommandBuffer, 0);
+        }
+    } else {
+        openBatch = {};
+        openBatch.commandBuffer = allocateCommandBuffer(commandPool);
+        if (dedicatedTransfer) {
+            openBatch.graphicsCommandBuffer = allocateCommandBuffer(graphicsCommandPool);
+        }
+    }
+    openBatch.token = nextToken;
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(openBatch.commandBuffer, &beginInfo);
+    if (dedicatedTransfer) {
+        vkBeginCommandBuffer(openBatch.graphicsCommandBuffer, &beginInfo);
+    }
+
+    hasOpenBatch = true;
+}
+
+VkCommandBuffer UploadManager::getCommandBuffer()
+{
+    beginBatch();
+    return openBatch.commandBuffer;
+}
+
+VkCommandBuffer UploadManager::getGraphicsCommandBuffer()
+{
+    beginBatch();
+    return dedicatedTransfer ? openBatch.graphicsCommandBuffer : openBatch.commandBuffer;
+}
+
+UploadManager::StagingAllocation UploadManager::allocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Staging alignment must be a power of two");
+    beginBatch();
+
+    const uint64_t ringSize = stagingRing->getBufferSize();
+    StagingAllocation allocation {};
+
+    if (size > ringSize / 2) {
+        auto buffer = std::make_unique<Buffer>(
+            treDevice,
+            size,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        buffer->map();
+        allocation.buffer = buffer->getBuffer();
+        allocation.mapped = buffer->getMappedMemory();
+        openBatch.oversizedStaging.push_back(std::move(buffer));
+        return allocation;
+    }
+
+    auto place = [&](uint64_t head) {
+        uint64_t offset = (head + alignment - 1) & ~(alignment - 1);
+        // Never straddle the end of the ring.
+        if (offset % ringSize + size > ringSize) {
+            offset = (offset / ringSize + 1) * ringSize;
+        }
+        return offset;
+    };
+
+    uint64_t offset = place(ringHead);
+    while (offset + size - ringTail > ringSize) {
+        if (pendingBatches.empty()) {
+            // The open batch alone fills the ring; submit it so its space can be recycled.
+            flush();
+            retireOldest();
+            beginBatch();
+        } else {
+            retireOldest();
+        }
+        offset = place(ringHead);
+    }
+
+    ringHead = offset + size;
+    allocation.buffer = stagingRing->getBuffer();
+    allocation.offset = offset % ringSize;
+    allocation.mapped = static_cast<char*>(stagingRing->getMappedMemory()) + allocation.offset;
+    return allocation;
+}
+
+UploadManager::Token UploadManager::copyToBuffer(
+    VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+    StagingAllocation staging = allocateStaging(size);
+    std::memcpy(staging.mapped, data, size);
+
+    VkBufferCopy copyRegion {};
+    copyRegion.srcOffset = staging.offset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(openBatch.commandBuffer, staging.buffer, dstBuffer, 1, &copyRegion);
+
+    if (dedicatedTransfer) {
+        VkBufferMemoryBarrier barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.buffer = dstBuffer;
+        barrier.offset = dstOffset;
+        barrier.size = size;
+        openBatch.bufferTransfers.push_back(barrier);
+    }
+    return openBatch.token;
+}
+
+void UploadManager::transferImageToGraphics(VkImage image, const VkImageSubresourceRange& range,
+    VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    beginBatch();
+
+    VkImageMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.image = image;
+    barrier.subresourceRange = range;
+
+    if (!dedicatedTransfer) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        vkCmdPipelineBarrier(openBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0,
+            nullptr, 1, &barrier);
+        return;
+    }
+
+    // The release and acquire must describe the same transfer, layouts included; each side
+    // only gets the access mask of its own queue.
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(openBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(openBatch.graphicsCommandBuffer, TRANSFER_WAIT_STAGE, dstStage, 0, 0, nullptr,
+        0, nullptr, 1, &barrier);
+}
+
+void UploadManager::flush()
+{
+    if (!hasOpenBatch) {
+        return;
+    }
+
+    std::vector<VkBufferMemoryBarrier>& bufferTransfers = openBatch.bufferTransfers;
+    if (!bufferTransfers.empty()) {
+        for (auto& barrier : bufferTransfers) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+        }
+        vkCmdPipelineBarrier(openBatch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(bufferTransfers.size()),
+            bufferTransfers.data(), 0, nullptr);
+
+        for (auto& barrier : bufferTransfers) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        }
+        vkCmdPipelineBarrier(openBatch.graphicsCommandBuffer, TRANSFER_WAIT_STAGE, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0, 0, nullptr, static_cast<uint32_t>(bufferTransfers.size()), bufferTransfers.data(), 0, nullptr);
+    }
+
+    VkCommandBuffer graphicsCommandBuffer = dedicatedTransfer ? openBatch.graphicsCommandBuffer : openBatch.commandBuffer;
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+        1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(openBatch.commandBuffer) != VK_SUCCESS
+        || (dedicatedTransfer && vkEndCommandBuffer(graphicsCommandBuffer) != VK_SUCCESS)) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &openBatch.commandBuffer;
+    // Frames share the graphics timeline, so its values skip tokens; the batch keeps both.
+    Timeline& graphicsTimeline = treDevice.getGraphicsTimeline();
+    if (dedicatedTransfer) {
+        Timeline& transferTimeline = treDevice.getTransferTimeline();
+        Timeline::Value transferValue = transferTimeline.submit(treDevice.getTransferQueue(), submitInfo);
+        openBatch.timelineValue = graphicsTimeline.submitAfter(treDevice.getGraphicsQueue(), graphicsCommandBuffer,
+            transferTimeline, transferValue, TRANSFER_WAIT_STAGE);
+    } else {
+        openBatch.timelineValue = graphicsTimeline.submit(treDevice.getGraphicsQueue(), submitInfo);
+    }
+
+    openBatch.ringEnd = ringHead;
+    pendingBatches.push_back(std::move(openBatch));
+    openBatch = {};
+    hasOpenBatch = false;
+    nextToken++;
+}
+
+void UploadManager::retireOldest()
+{
+    Batch& batch = pendingBatches.front();
+    treDevice.getGraphicsTimeline().wait(batch.timelineValue);
+
+    ringTail = batch.ringEnd;
+    completedToken = batch.token;
+    batch.oversizedStaging.clear();
+    batch.bufferTransfers.clear();
+    freeBatches.push_back(std::move(batch));
+    pendingBatches.pop_front();
+}
+
+void UploadManager::retireCompleted()
+{
+    while (!pendingBatches.empty()
+        && treDevice.getGraphicsTimeline().isComplete(pendingBatches.front().timelineValue)) {
+        retireOldest();
+    }
+}
+
+bool UploadManager::isComplete(Token token)
+{
+    if (token <= completedToken) {
+        return true;
+    }
+    retireCompleted();
+    return token <= completedToken;
+}
+
+void UploadManager::wait(Token token)
+{
+    if (hasOpenBatch && token >= openBatch.token) {
+        flush();
+    }
+    while (token > completedToken && !pendingBatches.empty()) {
+        retireOldest();
+    }
+}
+} // namespace fte
@@ -0,0 +1,126 @@
+// Compares ObjLoader against tinyobj::LoadObj: checks both produce identical attribute
+// and index streams, then reports the best-of-N wall time of each.
+#include "obj_loader.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Reference {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::index_t> indices;
+};
+
+Reference loadReference(const std::string& filepath)
+{
+    Reference reference {};
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    if (!tinyobj::LoadObj(&reference.attrib, &shapes, &materials, &err, filepath.c_str())) {
+        throw std::runtime_error(err);
+    }
+    for (const auto& shape : shapes) {
+        reference.indices.insert(reference.indices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+    }
+    return reference;
+}
+
+bool sameFloats(const std::vector<float>& a, const std::vector<float>& b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+bool matches(const Reference& reference, const fte::ObjLoader::Mesh& mesh)
+{
+    if (!sameFloats(reference.attrib.vertices, mesh.positions)
+        || !sameFloats(reference.attrib.normals, mesh.normals)
+        || !sameFloats(reference.attrib.texcoords, mesh.texcoords)
+        || reference.indices.size() != mesh.indices.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        const auto& expected = reference.indices[i];
+        const auto& actual = mesh.indices[i];
+        if (expected.vertex_index != actual.vertexIndex
+            || expected.normal_index != actual.normalIndex
+            || expected.texcoord_index != actual.texcoordIndex) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename F>
+double bestMilliseconds(int iterations, F&& f)
+{
+    double best = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        f();
+        std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = 5;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else {
+            files.emplace_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        files = {
+            ENGINE_DIR "assets/models/tiny_frog/model.obj",
+            ENGINE_DIR "assets/models/fox_in_a_cape/model.obj",
+        };
+    }
+
+    fte::ThreadPool& pool = fte::ThreadPool::shared();
+    std::cout << "ObjLoader using " << pool.getThreadCount() + 1 << " threads, best of " << iterations << " runs\n";
+
+    int result = EXIT_SUCCESS;
+    for (const auto& file : files) {
+        try {
+            Reference reference = loadReference(file);
+            fte::ObjLoader::Mesh mesh = fte::ObjLoader::load(file, pool);
+            bool identical = matches(reference, mesh);
+            if (!identical) {
+                result = EXIT_FAILURE;
+            }
+
+            double tinyobjTime = bestMilliseconds(iterations, [&]() { loadReference(file); });
+            double objLoaderTime = bestMilliseconds(iterations, [&]() { fte::ObjLoader::load(file, pool); });
+
+            std::cout << file << "\n"
+                      << "  vertices " << mesh.positions.size() / 3 << ", indices " << mesh.indices.size()
+                      << ", output " << (identical ? "identical" : "MISMATCH") << "\n"
+                      << "  tinyobj::LoadObj " << tinyobjTime << " ms\n"
+                      << "  ObjLoader        " << objLoaderTime << " ms (" << tinyobjTime / objLoaderTime << "x)\n";
+        } catch (const std::exception& e) {
+            std::cerr << file << ": " << e.what() << '\n';
+            result = EXIT_FAILURE;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+// Packs asset directories into one Archive for AssetFileSystem to mount. Paths are stored
+// relative to the root, so mount the result at that same directory:
+//   fte_packer [--store] <output.fta> <root> [directory...]
+// With no directories, everything under root is packed. Generated caches (*.ftemesh,
+// *.bc7.ktx2, ...) are included on purpose so a packed build never rebuilds them.
+#include "archive.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+namespace fs = std::filesystem;
+
+bool isPackable(const fs::path& path)
+{
+    std::string extension = path.extension().string();
+    return extension != ".tmp" && extension != ".fta";
+}
+
+void collect(const fs::path& root, const fs::path& directory, fte::Archive::FileList& files)
+{
+    for (const auto& item : fs::recursive_directory_iterator(directory)) {
+        if (item.is_regular_file() && isPackable(item.path())) {
+            files.emplace_back(item.path().lexically_relative(root).generic_string(), item.path().string());
+        }
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    bool compress = true;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--store") == 0) {
+            compress = false;
+        } else {
+            arguments.emplace_back(argv[i]);
+        }
+    }
+    if (arguments.size() < 2) {
+        std::cerr << "usage: fte_packer [--store] <output.fta> <root> [directory...]\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::string& outputPath = arguments[0];
+    fs::path root = fs::path(arguments[1]).lexically_normal();
+    std::vector<fs::path> directories;
+    for (size_t i = 2; i < arguments.size(); i++) {
+        directories.push_back(root / arguments[i]);
+    }
+    if (directories.empty()) {
+        directories.push_back(root);
+    }
+
+    fte::Archive::FileList files;
+    try {
+        for (const auto& directory : directories) {
+            collect(root, directory, files);
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    // Sorted so the same input always produces the same archive.
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    auto start = std::chrono::steady_clock::now();
+    if (!fte::Archive::write(outputPath, files, compress)) {
+        return EXIT_FAILURE;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    fte::Archive archive {};
+    if (!archive.open(outputPath)) {
+        std::cerr << "failed to reopen " << outputPath << '\n';
+        return EXIT_FAILURE;
+    }
+
+    uint64_t totalSize = 0;
+    for (const auto& file : files) {
+        totalSize += archive.find(file.first)->size;
+    }
+    std::cout << outputPath << ": " << files.size() << " files, " << totalSize << " -> "
+              << archive.header().fileSize << " bytes in " << elapsed.count() << " ms\n";
+    return EXIT_SUCCESS;
+}